@@ -0,0 +1,49 @@
+#include "../single_include/tui/tui.hpp"
+
+#ifdef IS_POSIX
+int main() {
+    // Construct window
+    tui::Window window;
+
+    window.set_title("Broadcast Example");
+
+    // Serve every rendered frame to clients of broadcast_client
+    tui::BroadcastServer server("/tmp/tui-broadcast.sock");
+    window.attach(server);
+
+    tui::Paragraph p;
+    p.text = "Attach with ./broadcast_client /tmp/tui-broadcast.sock";
+    p.set_dimensions(0, 0, 40, 4);
+
+    tui::Gauge g;
+    g.title = "Progress";
+    g.set_dimensions(0, 4, 40, 3);
+    g.bar_color = tui::GREEN;
+
+    bool quit = false;
+    tui::Event event;
+    int frame = 0;
+
+    while(!quit) {
+        if(window.poll_event(event)) {
+            if(event.type == tui::KEYDOWN && event.key == 'q') {
+                quit = true;
+            }
+        }
+        g.percent = (frame++ / 10) % 101;
+        g.label = std::to_string(g.percent) + "%";
+        window.add(p, g);
+        window.render();
+    }
+
+    window.close();
+    return 0;
+}
+#else
+#include <iostream>
+
+int main() {
+    std::cout << "Broadcasting is only available on unix" << std::endl;
+    return 0;
+}
+#endif
@@ -0,0 +1,65 @@
+// Attach to a tui::BroadcastServer and show its frames, press q to detach
+#ifndef _WIN32
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <termios.h>
+#include <unistd.h>
+
+int main(int argc, char *argv[]) {
+    if(argc < 2) {
+        fprintf(stderr, "Usage: broadcast_client <socket>\n");
+        return 1;
+    }
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, argv[1], sizeof(address.sun_path) - 1);
+    if(connect(server, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        perror("connect");
+        return 1;
+    }
+    // Read keys without echo and switch to the alternate screen
+    struct termios default_mode;
+    tcgetattr(STDIN_FILENO, &default_mode);
+    struct termios mode = default_mode;
+    mode.c_lflag &= ~(ICANON | ECHO);
+    tcsetattr(STDIN_FILENO, TCSANOW, &mode);
+    fputs("\x1B[?1049h\x1B[?25l", stdout);
+    fflush(stdout);
+
+    struct pollfd fds[2] = {{server, POLLIN, 0}, {STDIN_FILENO, POLLIN, 0}};
+    char buffer[1 << 16];
+    bool quit = false;
+    while(!quit && poll(fds, 2, -1) > 0) {
+        if(fds[0].revents) {
+            ssize_t count = read(server, buffer, sizeof(buffer));
+            if(count <= 0) {
+                break;
+            }
+            fwrite(buffer, 1, count, stdout);
+            fflush(stdout);
+        }
+        if(fds[1].revents) {
+            char key;
+            quit = read(STDIN_FILENO, &key, 1) <= 0 || key == 'q';
+        }
+    }
+
+    fputs("\x1B[0m\x1B[?25h\x1B[?1049l", stdout);
+    fflush(stdout);
+    tcsetattr(STDIN_FILENO, TCSANOW, &default_mode);
+    close(server);
+    return 0;
+}
+#else
+#include <stdio.h>
+
+int main() {
+    printf("Broadcasting is only available on unix\n");
+    return 0;
+}
+#endif
@@ -0,0 +1,72 @@
+#include "../single_include/tui/tui.hpp"
+
+#ifdef TUI_COROUTINES
+// Count the seconds since start
+tui::Task<> clock_task(tui::EventLoop &loop, tui::Paragraph &clock) {
+    for(int seconds = 0; ; seconds++) {
+        clock.set_text(std::to_string(seconds) + "s since start");
+        co_await loop.sleep_for(std::chrono::seconds(1));
+    }
+}
+
+// Simulate a slow request answered on another thread
+tui::Task<std::string> fetch(tui::EventLoop &loop, int request) {
+    std::string answer = co_await loop.run_in_thread([request]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(700));
+        return "Response " + std::to_string(request);
+    });
+    co_return answer;
+}
+
+// Handle keys, the loop stops when this task finishes
+tui::Task<> input_task(tui::EventLoop &loop, tui::Paragraph &status) {
+    int requests = 0;
+    while(true) {
+        tui::Event event = co_await loop.next_event();
+        if(event.type != tui::KEYDOWN) {
+            continue;
+        }
+        if(event.key == 'q') {
+            loop.stop();
+            co_return;
+        } else if(event.key == 'f') {
+            status.set_text("Fetching...");
+            // Input keeps being queued while waiting, the clock keeps running
+            status.set_text(co_await fetch(loop, ++requests));
+        }
+    }
+}
+
+int main() {
+    // Construct window
+    tui::Window window;
+
+    window.set_title("Coroutine Example");
+
+    tui::Paragraph clock;
+    clock.title = "Clock";
+    clock.set_dimensions(0, 0, 30, 3);
+
+    tui::Paragraph status;
+    status.title = "Press f to fetch, q to quit";
+    status.text = "Idle";
+    status.set_dimensions(0, 3, 30, 3);
+
+    tui::EventLoop loop(window);
+    loop.spawn(clock_task(loop, clock));
+    loop.spawn(input_task(loop, status));
+    loop.run([&]() {
+        window.add(clock, status);
+    });
+
+    window.close();
+    return 0;
+}
+#else
+#include <cstdio>
+
+int main() {
+    puts("The coroutine example requires C++20");
+    return 0;
+}
+#endif
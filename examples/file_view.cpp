@@ -0,0 +1,58 @@
+#include "../single_include/tui/tui.hpp"
+
+int main(int argc, char **argv) {
+    // Construct window
+    tui::Window window;
+
+    window.set_title("File View Example");
+
+    // The file is mapped, lines show up while they are indexed
+    tui::FileView file_view;
+    file_view.title = argc > 1 ? argv[1] : __FILE__;
+    file_view.open(file_view.title);
+    file_view.set_dimensions(0, 0, 80, 20);
+
+    tui::Paragraph status;
+    status.set_dimensions(0, 20, 80, 3);
+
+    bool quit = false;
+    tui::Event event;
+
+    while(!quit) {
+        // Show indexed lines and follow the file while it grows
+        file_view.poll();
+        status.text = std::to_string(file_view.size()) + " lines" + (file_view.busy() ? ", indexing" : "") +
+            (file_view.follow ? ", following" : "") + " - j/k/space/b: scroll, g/G: top/end, q: quit";
+        window.add(file_view, status);
+        window.render();
+        // Check back soon while indexing, or for appended lines
+        if(window.wait_event(event, file_view.busy() ? 16 : 250) && event.type == tui::KEYDOWN) {
+            switch(event.key) {
+                case 'q':
+                    quit = true;
+                    break;
+                case 'j':
+                    file_view.scroll_down();
+                    break;
+                case 'k':
+                    file_view.scroll_up();
+                    break;
+                case ' ':
+                    file_view.scroll_down(file_view.height - 2);
+                    break;
+                case 'b':
+                    file_view.scroll_up(file_view.height - 2);
+                    break;
+                case 'g':
+                    file_view.scroll_up(INT_MAX);
+                    break;
+                case 'G':
+                    file_view.scroll_down(INT_MAX);
+                    break;
+            }
+        }
+    }
+
+    window.close();
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include "../single_include/tui/tui.hpp"
+
+// Return true if key erases the last character
+bool is_backspace(int key) {
+#ifdef IS_POSIX
+    if(key == KEY_BACKSPACE) {
+        return true;
+    }
+#endif
+    return key == 8 || key == 127;
+}
+
+int main() {
+    // Construct window
+    tui::Window window;
+
+    window.set_title("Filter Example");
+
+    tui::List list;
+    list.title = "Hosts";
+    const char *roles[] = {"web", "db", "cache", "queue", "search"};
+    const char *regions[] = {"us-east", "us-west", "eu-west", "ap-south"};
+    for(int i = 0; i < 100000; i++) {
+        list.rows.push_back(std::string(roles[i % 5]) + "-" + std::to_string(i % 997) + "." + regions[i % 4] + ".example.com");
+    }
+    list.set_dimensions(0, 3, 40, 16);
+
+    // Matching runs on worker threads, the list is only changed in poll()
+    tui::FuzzyFilter filter;
+    filter.set_rows(list.rows);
+
+    tui::Paragraph query;
+    query.title = "Type to filter, Esc: quit";
+    query.set_dimensions(0, 0, 40, 3);
+
+    std::string text;
+    bool quit = false;
+    tui::Event event;
+
+    while(!quit) {
+        // Show finished searches
+        if(filter.poll()) {
+            filter.apply(list);
+        }
+        query.text = text;
+        window.add(query, list);
+        window.render();
+        // Check back soon while a search runs
+        if(window.wait_event(event, filter.busy() ? 16 : -1) && event.type == tui::KEYDOWN) {
+            if(event.key == 27) {
+                quit = true;
+            } else if(is_backspace(event.key)) {
+                if(!text.empty()) {
+                    text.pop_back();
+                    filter.search(text);
+                    if(text.empty()) {
+                        filter.apply(list);
+                    }
+                }
+            } else if(event.key == 'j' - 'a' + 1) {
+                list.scroll_down(window);
+            } else if(event.key == 'k' - 'a' + 1) {
+                list.scroll_up(window);
+            } else if(event.key >= ' ' && event.key < 127) {
+                text += (char)event.key;
+                filter.search(text);
+            }
+        }
+    }
+
+    window.close();
+    return 0;
+}
\ No newline at end of file
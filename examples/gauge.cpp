@@ -25,20 +25,25 @@ int main() {
     bool quit = false;
     tui::Event event;
 
-    // Add bar gauge widgets to the window
-    window.add(g0, g1);
-
     while(!quit) {
-        if(window.poll_event(event)) {
+        // Add bar gauge widgets to the window
+        g1.label = std::to_string(g1.percent) + "%";
+        window.add(g0, g1);
+        window.render();
+        // Sleep until a key is pressed or the animation moves
+        if(window.wait_event(event)) {
             if(event.type == tui::KEYDOWN) {
                 switch(event.key) {
                     case 'q':
                         quit = true;
                         break;
+                    case ' ':
+                        // Animate the big gauge between 30% and 90%
+                        window.animate(g1.percent, g1.percent < 60 ? 90 : 30, 500);
+                        break;
                 }
             }
         }
-        window.render();
     }
 
     window.close();
@@ -0,0 +1,56 @@
+#include "../single_include/tui/tui.hpp"
+
+int main() {
+    // Construct window
+    tui::Window window;
+
+    window.set_title("Heatmap Example");
+
+    // Load of 64 cores over 1600 samples
+    const int cores = 64;
+    const int samples = 1600;
+    std::vector<float> load(cores * samples);
+
+    tui::Heatmap heatmap;
+    heatmap.title = "Core load";
+    heatmap.set_values(load.data(), cores, samples);
+    heatmap.set_dimensions(0, 0, 60, 18);
+    heatmap.pooling = tui::MAX_POOLING;
+
+    // Refresh the matrix every second
+    int tick = 0;
+    auto refresh = [&]() {
+        for(int i = 0; i < cores; i++) {
+            for(int j = 0; j < samples; j++) {
+                load[i * samples + j] = 0.5f + 0.5f * sinf((i + tick) * 0.2f + j * 0.01f);
+            }
+        }
+        tick++;
+        heatmap.touch();
+    };
+    refresh();
+    window.set_interval(1000, refresh);
+
+    bool quit = false;
+    tui::Event event;
+
+    while(!quit) {
+        window.add(heatmap);
+        window.render();
+        if(window.wait_event(event) && event.type == tui::KEYDOWN) {
+            switch(event.key) {
+                case 'q':
+                    quit = true;
+                    break;
+                case 'p':
+                    // Toggle pooling
+                    heatmap.pooling = heatmap.pooling == tui::MAX_POOLING ? tui::MEAN_POOLING : tui::MAX_POOLING;
+                    heatmap.touch();
+                    break;
+            }
+        }
+    }
+
+    window.close();
+    return 0;
+}
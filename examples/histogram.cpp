@@ -0,0 +1,50 @@
+#include "../single_include/tui/tui.hpp"
+
+int main() {
+    // Construct window
+    tui::Window window;
+
+    window.set_title("Histogram Example");
+
+    tui::Histogram histogram;
+    histogram.title = "Latency (us)";
+    histogram.set_log_bins(10, 10000, 12);
+    histogram.bar_width = 4;
+    histogram.bar_color = tui::GREEN;
+    histogram.set_dimensions(0, 0, 62, 15);
+
+    tui::Paragraph percentiles;
+    percentiles.set_dimensions(0, 15, 62, 3);
+
+    // Simulate a burst of request latencies every 100 ms
+    std::vector<double> samples(10000);
+    window.set_interval(100, [&]() {
+        for(double &sample : samples) {
+            double uniform = (rand() + 1.0) / ((double)RAND_MAX + 2.0);
+            sample = 50 - 150 * log(uniform);
+        }
+        histogram.push(samples.data(), samples.size());
+    });
+    // Older samples lose half their weight every second
+    window.set_interval(1000, [&]() {
+        histogram.decay(0.5);
+    });
+
+    bool quit = false;
+    tui::Event event;
+
+    while(!quit) {
+        char text[64];
+        snprintf(text, sizeof(text), "p50 %.0f  p95 %.0f  p99 %.0f",
+            histogram.percentile(50), histogram.percentile(95), histogram.percentile(99));
+        percentiles.set_text(text);
+        window.add(histogram, percentiles);
+        window.render();
+        if(window.wait_event(event) && event.type == tui::KEYDOWN && event.key == 'q') {
+            quit = true;
+        }
+    }
+
+    window.close();
+    return 0;
+}
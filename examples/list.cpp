@@ -23,11 +23,18 @@ int main() {
     l.text_style.foreground = tui::YELLOW;
     l.set_dimensions(0, 0, 25, 8);
 
+    // Measure how long events take to show, printed after closing
+    window.set_latency_tracking(true);
+    window.set_mouse_hover(true);
+
     bool quit = false;
-    tui::Event event;
+    tui::Event events[64];
 
     while(!quit) {
-        if(window.poll_event(event)) {
+        // Handle every pending event before rendering once
+        size_t count = window.poll_events(events);
+        for(size_t i = 0; i < count; i++) {
+            const tui::Event &event = events[i];
             if(event.type == tui::KEYDOWN) {
                 switch(event.key) {
                     case 'q':
@@ -40,6 +47,9 @@ int main() {
                         l.scroll_up(window);
                         break;
                 }
+            } else {
+                // Click to select, wheel to scroll, rows under the pointer are highlighted
+                l.handle_event(window, event);
             }
         }
         // Add list widget to the window
@@ -50,5 +60,6 @@ int main() {
     }
 
     window.close();
+    fputs(window.latency().report().c_str(), stdout);
     return 0;
 }
\ No newline at end of file
@@ -37,11 +37,16 @@ int main() {
     p4.set_dimensions(60, 0, 40, 15);
     p4.border_style.foreground = tui::BLUE;
 
+    tui::Paragraph p5;
+    p5.title = "Rich Text";
+    p5.set_markup("[green]INFO[/] server started, [bold yellow]WARN[/] disk [underline]80%[/] full, [white on red]ERROR[/] connection lost");
+    p5.set_dimensions(0, 15, 59, 4);
+
     bool quit = false;
     tui::Event event;
 
     // Add paragraph widgets to the window
-    window.add(p0, p1, p2, p3, p4);
+    window.add(p0, p1, p2, p3, p4, p5);
 
     while(!quit) {
         if(window.poll_event(event)) {
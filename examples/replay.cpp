@@ -0,0 +1,26 @@
+#include "../single_include/tui/tui.hpp"
+#include <iostream>
+
+int main(int argc, char *argv[]) {
+    if(argc < 2) {
+        std::cerr << "Usage: replay <recording> [--fast]" << std::endl;
+        return 1;
+    }
+    bool fast = argc > 2 && std::string(argv[2]) == "--fast";
+
+    // Load recording before taking over the terminal
+    tui::FrameReplayer replayer(argv[1]);
+
+    // Construct window
+    tui::Window window;
+
+    window.set_title("Replay Example");
+
+    auto start = std::chrono::steady_clock::now();
+    size_t frames = replayer.replay(window, fast ? tui::UNTHROTTLED : tui::REALTIME);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    window.close();
+    std::cout << frames << " frames in " << elapsed.count() << " s" << std::endl;
+    return 0;
+}
@@ -0,0 +1,61 @@
+#include "../single_include/tui/tui.hpp"
+
+int main() {
+    // Construct window
+    tui::Window window;
+
+    window.set_title("Table Example");
+
+    tui::Table table;
+    table.title = "Processes";
+    table.add_column("Command");
+    table.add_column("Pid", tui::TableColumn::INTEGER);
+    table.add_column("Cpu", tui::TableColumn::REAL, 1);
+    const char *commands[] = {"bash", "vim", "make", "g++", "ssh", "top"};
+    for(int i = 0; i < 200000; i++) {
+        table.add_row(commands[i % 6], (i * 7919) % 100003, (i % 997) / 10.0);
+    }
+    table.set_dimensions(0, 0, 40, 15);
+
+    tui::Paragraph help;
+    help.text = "s: sort, f: filter vim, c: clear, j/k: scroll, q: quit";
+    help.set_dimensions(0, 15, 40, 4);
+
+    bool quit = false;
+    tui::Event event;
+
+    while(!quit) {
+        // Show finished sorts and filters
+        table.poll();
+        window.add(table, help);
+        window.render();
+        // Check back soon while the table is busy
+        if(window.wait_event(event, table.busy() ? 16 : -1) && event.type == tui::KEYDOWN) {
+            switch(event.key) {
+                case 'q':
+                    quit = true;
+                    break;
+                case 's':
+                    // Sort by the next column
+                    table.sort_by((table.sort_column + 1) % 3);
+                    break;
+                case 'f':
+                    table.filter_by(0, "vim");
+                    break;
+                case 'c':
+                    table.filter_by(0, "");
+                    table.sort_by(-1);
+                    break;
+                case 'j':
+                    table.scroll_down();
+                    break;
+                case 'k':
+                    table.scroll_up();
+                    break;
+            }
+        }
+    }
+
+    window.close();
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include "../single_include/tui/tui.hpp"
+
+int main() {
+    // Construct window
+    tui::Window window;
+
+    window.set_title("Tabs Example");
+
+    // One pane per host, only the pane shown is drawn and refreshed
+    const int hosts = 20;
+    std::vector<tui::Gauge> cpu(hosts);
+    std::vector<tui::Gauge> memory(hosts);
+    std::vector<tui::Paragraph> log(hosts);
+
+    tui::PaneStack panes;
+    panes.set_dimensions(0, 0, 80, 16);
+    for(int i = 0; i < hosts; i++) {
+        cpu[i].title = "CPU";
+        cpu[i].set_dimensions(0, 1, 40, 3);
+        cpu[i].bar_color = tui::GREEN;
+        cpu[i].percent = 0;
+        memory[i].title = "Memory";
+        memory[i].set_dimensions(40, 1, 40, 3);
+        memory[i].bar_color = tui::YELLOW;
+        memory[i].percent = 0;
+        log[i].title = "Log";
+        log[i].set_dimensions(0, 4, 80, 12);
+        size_t pane = panes.add_pane(std::to_string(i), cpu[i], memory[i], log[i]);
+        panes.set_refresh(pane, 500, [&, i]() {
+            // Stand-in for polling the host
+            static unsigned seed = 1;
+            seed = seed * 1103515245 + 12345;
+            int load = (seed >> 16) % 100;
+            cpu[i].set_percent(load);
+            cpu[i].set_label(std::to_string(load) + "%");
+            memory[i].set_percent(40 + load / 4);
+            log[i].append(load > 80 ? "high " : "ok ", load > 80 ? tui::Style{tui::RED, tui::BLACK} : tui::Style{tui::GREEN, tui::BLACK});
+            log[i].append(std::to_string(load) + "% ");
+        });
+    }
+
+    tui::Paragraph help;
+    help.text = "Tab/click: switch host, q: quit";
+    help.set_dimensions(0, 16, 80, 3);
+
+    bool quit = false;
+    tui::Event event;
+
+    while(!quit) {
+        window.add(panes);
+        window.add(help);
+        window.render();
+        // Sleep until an event arrives or the shown pane is due to refresh
+        if(window.wait_event(event, panes.next_timeout())) {
+            if(event.type == tui::KEYDOWN) {
+                switch(event.key) {
+                    case 'q':
+                        quit = true;
+                        break;
+                    case '\t':
+                        panes.select((panes.active() + 1) % panes.size());
+                        break;
+                }
+            } else {
+                panes.handle_event(window, event);
+            }
+        }
+    }
+
+    window.close();
+    return 0;
+}
@@ -6,31 +6,93 @@
 #include <windows.h>
 #else
 #   define IS_POSIX
+#include <errno.h>
+#include <fcntl.h>
 #include <ncurses.h>
+#include <poll.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #include <unistd.h>
 #endif
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
 #include <math.h>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <stdlib.h>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 
+// Coroutine front-end, when compiled as C++20
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#   define TUI_COROUTINES
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <optional>
+#endif
+#endif
+
 namespace tui {
     // Event handling
     enum EventType {
         KEYDOWN,
         MOUSEBUTTONDOWN,
+        MOUSEBUTTONUP,
+        MOUSEMOTION,
+        MOUSEWHEEL,
+        FOCUSIN,
+        FOCUSOUT,
+        PASTE,
+        WINDOWRESIZE,
         UNDEFINED
     };
 
+    // Modifier flags of an event
+    enum Modifier {
+        MOD_NONE  = 0,
+        MOD_SHIFT = 1,
+        MOD_ALT   = 2,
+        MOD_CTRL  = 4
+    };
+
+    enum MouseButton {
+        BUTTON_NONE   = 0,
+        BUTTON_LEFT   = 1,
+        BUTTON_MIDDLE = 2,
+        BUTTON_RIGHT  = 3
+    };
+
 #ifdef IS_WIN
     struct Event {
         EventType type = UNDEFINED;
         uint8_t key;
+        int modifiers = MOD_NONE;
+        int x = 0;                  // Column of mouse events
+        int y = 0;                  // Row of mouse events
+        int button = BUTTON_NONE;   // Button of mouse events
+        int wheel = 0;              // Wheel steps, positive is down
+        const char *text = nullptr; // Pasted text (not null terminated)
+        size_t length = 0;          // Length of pasted text
+        std::chrono::steady_clock::time_point time; // When the input was read
     };
 
     // Color handling
@@ -56,6 +118,14 @@ namespace tui {
     struct Event {
         EventType type = UNDEFINED;
         int key;
+        int modifiers = MOD_NONE;
+        int x = 0;                  // Column of mouse events
+        int y = 0;                  // Row of mouse events
+        int button = BUTTON_NONE;   // Button of mouse events
+        int wheel = 0;              // Wheel steps, positive is down
+        const char *text = nullptr; // Pasted text (not null terminated)
+        size_t length = 0;          // Length of pasted text
+        std::chrono::steady_clock::time_point time; // When the input was read
     };
 
     // Color handling
@@ -71,47 +141,215 @@ namespace tui {
     };
 #endif
 
+    // Merge repeated events in place and return the new number of events
+    // Consecutive wheel events at one position are summed into one delta,
+    // consecutive motion events keep only the latest position and
+    // only the last of several resize events is kept.
+    // Merged events keep the time of the earliest input.
+    inline size_t coalesce_events(Event *events, size_t count) {
+        size_t result = 0;
+        size_t resize = count; // Index of kept resize event
+        for(size_t i = 0; i < count; i++) {
+            const Event &event = events[i];
+            if(result > 0) {
+                Event &previous = events[result - 1];
+                if(
+                    event.type == MOUSEWHEEL && previous.type == MOUSEWHEEL &&
+                    event.x == previous.x && event.y == previous.y &&
+                    event.modifiers == previous.modifiers) {
+                    previous.wheel += event.wheel;
+                    continue;
+                }
+                if(
+                    event.type == MOUSEMOTION && previous.type == MOUSEMOTION &&
+                    event.button == previous.button && event.modifiers == previous.modifiers) {
+                    std::chrono::steady_clock::time_point time = previous.time;
+                    previous = event;
+                    previous.time = time;
+                    continue;
+                }
+            }
+            std::chrono::steady_clock::time_point time = event.time;
+            if(event.type == WINDOWRESIZE) {
+                if(resize < result) {
+                    // Drop earlier resize
+                    time = std::min(time, events[resize].time);
+                    std::move(events + resize + 1, events + result, events + resize);
+                    result--;
+                }
+                resize = result;
+            }
+            events[result] = event;
+            events[result++].time = time;
+        }
+        return result;
+    }
+
     // Return color after bitwise operation as short
     // Combines foreground and background
-    inline short get_color(short foreground, short background) {
+    constexpr inline short get_color(short foreground, short background) {
         return (foreground | (background << 4));
     }
 
+    // Text attributes of a style
+    enum Attribute {
+        ATTR_NONE      = 0,
+        ATTR_BOLD      = 1,
+        ATTR_DIM       = 2,
+        ATTR_ITALIC    = 4,
+        ATTR_UNDERLINE = 8,
+        ATTR_REVERSE   = 16
+    };
+
+    // Return a true color, drawn as the nearest color the terminal supports
+    constexpr inline int rgb(int red, int green, int blue) {
+        return 0x1000000 | (red << 16) | (green << 8) | blue;
+    }
+
+    // Colors and attributes of a cell
+    // Colors are Color values, indices 16-255 of the 256 color palette or rgb() colors
+    struct Style {
+        int foreground = WHITE;
+        int background = BLACK;
+        int attributes = ATTR_NONE;
+    };
+
+    inline bool operator==(const Style &style1, const Style &style2) {
+        return (
+            style1.foreground == style2.foreground &&
+            style1.background == style2.background &&
+            style1.attributes == style2.attributes
+        );
+    }
+
+    inline bool operator!=(const Style &style1, const Style &style2) {
+        return !(style1 == style2);
+    }
+
+    namespace detail {
+        // Return a new unique widget id
+        inline uint64_t next_widget_id() {
+            static std::atomic<uint64_t> counter{0};
+            return ++counter;
+        }
+
+        // Mix value into a running hash
+        inline uint64_t hash_combine(uint64_t seed, uint64_t value) {
+            seed ^= value + 0x9E3779B97F4A7C15ULL + (seed << 6) + (seed >> 2);
+            return seed * 0xFF51AFD7ED558CCDULL;
+        }
+    }
+
+    // Rectangle of cells
+    struct Rect {
+        int x = 0;
+        int y = 0;
+        int width = 0;
+        int height = 0;
+
+        inline bool empty() const {
+            return width <= 0 || height <= 0;
+        }
+
+        // Return true if the cell at x and y lies inside this rectangle
+        inline bool contains(int x_, int y_) const {
+            return x_ >= x && x_ < x + width && y_ >= y && y_ < y + height;
+        }
+
+        // Return true if other lies completely inside this rectangle
+        inline bool contains(const Rect &other) const {
+            return (
+                other.x >= x && other.y >= y &&
+                other.x + other.width <= x + width &&
+                other.y + other.height <= y + height
+            );
+        }
+
+        // Return the overlapping part of both rectangles
+        inline Rect intersect(const Rect &other) const {
+            int left = std::max(x, other.x);
+            int top = std::max(y, other.y);
+            int right = std::min(x + width, other.x + other.width);
+            int bottom = std::min(y + height, other.y + other.height);
+            return {left, top, std::max(0, right - left), std::max(0, bottom - top)};
+        }
+    };
+
     // Widget definitions
     struct Widget {
-        struct {
-            short foreground = WHITE;
-            short background = BLACK;
-        } border_style;
-        struct {
-            short foreground = WHITE;
-            short background = BLACK;
-        } text_style;
-        struct {
-            short foreground = WHITE;
-            short background = BLACK;
-        } title_style;
+        Style border_style;
+        Style text_style;
+        Style title_style;
         std::string title;
         bool border = true;
         int x;      // Position of left side of widget
         int y;      // Position of top of widget
         int width;  // Width of widget
         int height; // Height of widget
+        uint64_t id = detail::next_widget_id(); // Identity, shared by copies
+        uint64_t generation = 0; // Incremented by setters when content changes
+        int layer = 0;       // Stacked widgets on higher layers are drawn above lower layers
+        bool opaque = false; // Stacked widget hides everything below its rectangle
 
         void set_dimensions(int x, int y, int width, int height);
+        Rect rect() const;
+        void set_title(const std::string &title);
+        // Mark content as changed after modifying members directly
+        void touch();
+        // Return hash of generation, dimensions and styles
+        uint64_t fingerprint() const;
+    };
+
+    // Run of text drawn in style
+    struct TextSpan {
+        uint32_t offset = 0;
+        uint32_t length = 0;
+        Style style;
     };
 
+    inline bool operator==(const TextSpan &span1, const TextSpan &span2) {
+        return span1.offset == span2.offset && span1.length == span2.length && span1.style == span2.style;
+    }
+
     struct Paragraph : Widget {
         std::string text;
+        std::vector<TextSpan> spans; // Styled runs sorted by offset, other text is drawn in text_style
+
+        // Replace text, dropping spans
+        void set_text(const std::string &text);
+        // Replace text and spans with text marked up with style tags such as
+        // "[bold red]error[/] in [yellow on blue]main.cpp[/]", where "[/]" ends the last tag
+        // and "[[" is a "[". Brackets around anything else are kept as text.
+        void set_markup(const std::string &markup);
+        // Append text drawn in text_style, or in style merged into a preceding run of the same style
+        void append(const std::string &text);
+        void append(const std::string &text, const Style &style);
+        uint64_t fingerprint() const;
     };
 
     struct List : Widget{
         std::vector<std::string> rows;
         int first_element = 0; // Element at the top of the list
+        std::shared_ptr<const std::vector<uint32_t> > view; // Rows shown in order, every row when null
+        std::string highlight; // Characters matching this fuzzy query are drawn in highlight_style
+        Style highlight_style = {YELLOW, BLACK};
+        int selected = -1; // Position of the selected row among shown rows, -1 for none
+        Style selected_style = {BLACK, WHITE};
+        int hovered = -1;  // Position of the row under the mouse pointer, -1 for none
+        Style hover_style = {WHITE, BLUE};
+
+        void set_rows(const std::vector<std::string> &rows);
+        // Return the number of rows shown
+        size_t visible_size() const;
+        uint64_t fingerprint() const;
         template<typename Window>
         void scroll_up(Window &window, int factor = 1);
         template<typename Window>
         void scroll_down(Window &window, int factor = 1);
+        // Select rows on left click, scroll on wheel and track the hovered row
+        // Return true if the event was over the list
+        template<typename Window>
+        bool handle_event(Window &window, const Event &event);
     };
 
     struct BarChart : Widget {
@@ -119,24 +357,272 @@ namespace tui {
         std::vector<std::string> labels;
         int bar_width;
         short bar_color;
-        struct {
-            short foreground = WHITE;
-            short background = BLACK;
-        } label_style;
-        struct {
-            short foreground = WHITE;
-            short background = BLACK;
-        } number_style;
+        Style label_style;
+        Style number_style;
+
+        void set_data(const std::vector<int> &data);
+        void set_labels(const std::vector<std::string> &labels);
+        uint64_t fingerprint() const;
     };
 
     struct Gauge : Widget {
         int percent;
         std::string label;
         short bar_color;
-        struct {
-            short foreground = WHITE;
-            short background = BLACK;
-        } label_style;
+        Style label_style;
+
+        void set_percent(int percent);
+        void set_label(const std::string &label);
+        uint64_t fingerprint() const;
+    };
+
+    // Column of a Table stored as one typed vector
+    // Text is interned, every distinct string is stored once and cells hold its index.
+    struct TableColumn {
+        enum Type { INTEGER, REAL, TEXT };
+
+        std::string name;
+        Type type = TEXT;
+        int precision = 2; // Decimals of REAL values
+        std::vector<int64_t> integers;
+        std::vector<double> reals;
+        std::vector<uint32_t> texts;      // Index of every cell in strings
+        std::vector<std::string> strings; // Distinct strings
+        std::unordered_map<std::string, uint32_t> interned;
+        int width = 0; // Widest formatted value or name, kept up to date by push
+
+        size_t size() const;
+        // Append value converted to the type of the column
+        template<typename T>
+        void push(const T &value);
+        // Append an empty string, 0 or NaN
+        void push_empty();
+        // Return the text of row and set length, numbers are formatted into buffer
+        const char *format(size_t row, char (&buffer)[32], int &length) const;
+    };
+
+    // Columns of a table, shared with sorts and filters running on other threads
+    struct TableData {
+        std::vector<TableColumn> columns;
+        size_t rows = 0; // Length of every column
+        // Workers still reading the columns, released by each worker when it stops reading
+        mutable std::atomic<int> readers{0};
+
+        TableData() = default;
+        // Copies start without readers
+        TableData(const TableData &other) : columns(other.columns), rows(other.rows) {}
+    };
+
+    namespace detail {
+        // Sort or filter of a table computed on a worker thread
+        struct TableQuery {
+            std::atomic<bool> done{false};
+            std::atomic<bool> cancelled{false};
+            std::vector<uint32_t> rows; // Resulting view, owned by the worker until done
+        };
+    }
+
+    struct Table : Widget {
+        std::shared_ptr<TableData> data = std::make_shared<TableData>(); // Shared by copies until modified
+        std::shared_ptr<const std::vector<uint32_t> > view; // Rows shown in order, every row when null
+        int first_element = 0; // Element of the view below the header
+        Style header_style = {BLACK, WHITE};
+        int sort_column = -1;   // Column the view is sorted by, -1 for data order
+        bool ascending = true;
+        int filter_column = -1; // Column searched by filter_text, -1 for no filter
+        std::string filter_text;
+        std::shared_ptr<detail::TableQuery> query; // Sort or filter in progress
+        bool stale = false; // Data changed since the view was computed
+
+        // Append a column and return its index
+        int add_column(const std::string &name, TableColumn::Type type = TableColumn::TEXT, int precision = 2);
+        // Append one value to each column, in column order
+        // Columns without a value get an empty value, see TableColumn::push_empty
+        template<typename ... Values>
+        void add_row(const Values &... values);
+        void clear_rows();
+        // Return the number of rows of data and of the view
+        size_t size() const;
+        size_t visible_size() const;
+        // Sort or filter the view on the worker thread shared by all tables, poll() shows the result
+        // Filtering keeps the sort order and refines the previous view when text was extended
+        void sort_by(int column, bool ascending = true);
+        void filter_by(int column, const std::string &text);
+        // Return true while a sort or filter runs
+        bool busy() const;
+        // Swap in a finished sort or filter and restart it after data changes
+        // Returns true if the view changed
+        bool poll();
+        void scroll_up(int factor = 1);
+        void scroll_down(int factor = 1);
+        uint64_t fingerprint() const;
+        // Return columns for modification, copied first if a worker still reads them
+        TableData &edit();
+        void start_query(std::shared_ptr<const std::vector<uint32_t> > base, bool filter, bool sort);
+    };
+
+    enum Pooling {
+        MEAN_POOLING, // Cells show the mean of the values they cover
+        MAX_POOLING   // Cells show the largest value they cover
+    };
+
+    // Dense matrix drawn as one glyph or color per cell
+    // The matrix stays in caller memory, call touch() after changing its values.
+    struct Heatmap : Widget {
+        const float *values = nullptr; // Row major matrix of matrix_rows x matrix_columns values
+        int matrix_rows = 0;
+        int matrix_columns = 0;
+        float minimum = 0; // Value shown with the first glyph and color
+        float maximum = 1; // Value shown with the last glyph and color
+        Pooling pooling = MEAN_POOLING;
+        std::string ramp = " .:-=+*#%@"; // Glyphs from low to high values
+        std::vector<short> colors = {BLUE, CYAN, GREEN, YELLOW, RED}; // Colors from low to high values
+        bool half_blocks = true; // On Windows, draw two matrix rows per cell with colored half blocks
+
+        void set_values(const float *values, int rows, int columns);
+        void set_range(float minimum, float maximum);
+        uint64_t fingerprint() const;
+    };
+
+    enum BinScale {
+        LINEAR_BINS, // Bins of equal width
+        LOG_BINS,    // Bin edges grow by a constant factor
+        HDR_BINS     // Every power of two is split into equal sub buckets
+    };
+
+    // Bar chart of the distribution of pushed samples
+    // Counts are kept as doubles so they can decay, data holds them rounded for drawing.
+    struct Histogram : BarChart {
+        BinScale scale = LINEAR_BINS;
+        double minimum = 0;  // Lower edge of the first bin, the smallest step of HDR bins
+        double maximum = 1;  // Upper edge of the last bin, larger samples are counted in the last bin
+        int sub_bucket_bits = 0; // HDR bins split every power of two into 2^sub_bucket_bits buckets
+        std::vector<double> counts; // Number of samples in each bin
+        double total = 0;
+        std::vector<uint32_t> partial; // Counts of the current batch, four interleaved sets
+
+        // Replace the bins and clear the counts
+        void set_linear_bins(double minimum, double maximum, int bins);
+        void set_log_bins(double minimum, double maximum, int bins);
+        void set_hdr_bins(double unit, double maximum, int sub_bucket_bits);
+        void push(double sample);
+        void push(const double *samples, size_t count);
+        // Multiply every count by factor, e.g. 0.5 every second halves the weight of older samples
+        void decay(double factor);
+        void clear();
+        // Return the value at the lower edge of bin
+        double lower_edge(int bin) const;
+        // Return the estimated sample below which percent of the samples fall
+        double percentile(double percent) const;
+        int bin_of(double sample) const;
+        void reset_bins(int bins);
+    };
+
+    namespace detail {
+        // Read only mapping of a file, unmapped when the last user lets go
+        struct FileMapping {
+            const char *data = nullptr; // Null for empty files
+            uint64_t size = 0;
+#ifdef IS_WIN
+            HANDLE mapping = NULL;
+#endif
+
+            FileMapping() = default;
+            FileMapping(const FileMapping &) = delete;
+            FileMapping &operator=(const FileMapping &) = delete;
+            ~FileMapping();
+        };
+
+        // Open file of a FileView with the index of its line starts
+        // A worker thread appends to the index while holding mutex.
+        struct FileIndex {
+            static const uint64_t stride = 64; // Lines between checkpoints
+#ifdef IS_WIN
+            HANDLE handle = INVALID_HANDLE_VALUE;
+#elif defined(IS_POSIX)
+            int fd = -1;
+#endif
+            std::mutex mutex;
+            std::shared_ptr<const FileMapping> mapping; // Latest mapping of the whole file
+            std::vector<uint64_t> checkpoints{0}; // Offset of every stride-th line
+            uint64_t newlines = 0; // Line breaks in the indexed bytes
+            uint64_t indexed = 0;  // Bytes scanned for line breaks
+            uint64_t tail = 0;     // Offset after the last line break
+            uint64_t restarts = 0; // Incremented when indexing starts over
+            bool indexing = false; // A worker is scanning
+
+            FileIndex() = default;
+            FileIndex(const FileIndex &) = delete;
+            FileIndex &operator=(const FileIndex &) = delete;
+            ~FileIndex();
+        };
+    }
+
+    // Text file which is memory mapped instead of read
+    // Opening is O(1): line breaks are indexed by a worker thread and the lines indexed
+    // so far can be drawn and scrolled at once. Only every 64th line start is kept, and
+    // indexed pages are dropped again so only the pages drawn stay resident.
+    // poll() maps data appended to the file. Files must not be truncated while open:
+    // on POSIX, touching mapped pages past the new end raises SIGBUS before poll() can notice.
+    struct FileView : Widget {
+        std::shared_ptr<detail::FileIndex> file; // Shared by copies
+        uint64_t first_line = 0; // Line at the top
+        int first_column = 0;    // Column at the left
+        bool follow = false;     // Keep the last line in view while lines are added
+        int tab_width = 8;
+        uint64_t polled_lines = 0; // Lines and bytes when last polled
+        uint64_t polled_bytes = 0;
+
+        // Map the file at path and start indexing it, throws TUIException if it cannot be opened
+        void open(const std::string &path);
+        void close();
+        // Return the number of lines indexed so far
+        uint64_t size() const;
+        // Return true while lines are indexed
+        bool busy() const;
+        // Map data appended to the file and show newly indexed lines
+        // Returns true if the view changed
+        bool poll();
+        void scroll_up(int factor = 1);
+        void scroll_down(int factor = 1);
+        uint64_t fingerprint() const;
+    };
+
+    // Row of tab titles, the active one drawn in active_style
+    struct Tabs : Widget {
+        std::vector<std::string> titles;
+        int active = 0;
+        Style active_style = {BLACK, WHITE};
+
+        // Return the index of the tab at column x, -1 if there is none
+        int tab_at(int x) const;
+        uint64_t fingerprint() const;
+    };
+
+    // Fixed set of widgets stored by value
+    // Intended for layouts that are known at compile time
+    template<typename ... Widgets>
+    struct StaticScene {
+        std::tuple<Widgets...> widgets;
+
+        StaticScene() = default;
+        StaticScene(const Widgets &... widgets_) : widgets(widgets_...) {}
+
+        // Return widget at index I
+        template<std::size_t I>
+        auto &get() {
+            return std::get<I>(widgets);
+        }
+
+        template<std::size_t I>
+        const auto &get() const {
+            return std::get<I>(widgets);
+        }
+
+        // Return number of widgets in the scene
+        static constexpr std::size_t size() {
+            return sizeof...(Widgets);
+        }
     };
 
     // Widget comparisons
@@ -144,6 +630,7 @@ namespace tui {
         return (
             paragraph1.title == paragraph2.title &&
             paragraph1.text == paragraph2.text &&
+            paragraph1.spans == paragraph2.spans &&
             paragraph1.x == paragraph2.x &&
             paragraph1.y == paragraph2.y &&
             paragraph1.width == paragraph2.width &&
@@ -232,576 +719,6457 @@ namespace tui {
             TUIException(Args... args) : std::runtime_error(args...){}
     };
 
-    class Window {
-        public:
-            // Updates width, height, rows, and columns values
-            void update_dimensions() {
-                window_width = width();
-                window_height = height();
-                rows_ = rows();
-                columns_ = columns();
+    namespace detail {
+        // Return the rgb() color of an index of the 256 color palette above 15
+        inline int palette_rgb(int index) {
+            if(index >= 232) {
+                int gray = 8 + (index - 232) * 10;
+                return rgb(gray, gray, gray);
             }
+            index -= 16;
+            auto level = [](int step) {
+                return step == 0 ? 0 : 55 + step * 40;
+            };
+            return rgb(level(index / 36), level((index / 6) % 6), level(index % 6));
+        }
 
-            // Draw border with given widget dimensions
-            template<typename Widget>
-            void draw_border(Widget widget) {
-                short border_color = get_color(
-                    widget.border_style.foreground, 
-                    widget.border_style.background
+        // Return the index of the 256 color palette nearest to an rgb() color
+        inline int nearest_palette(int color) {
+            int red = (color >> 16) & 0xFF;
+            int green = (color >> 8) & 0xFF;
+            int blue = color & 0xFF;
+            auto step = [](int value) {
+                return value < 48 ? 0 : (value < 115 ? 1 : (value - 35) / 40);
+            };
+            return 16 + 36 * step(red) + 6 * step(green) + step(blue);
+        }
+
+        // Return the ANSI color (red 1, green 2, blue 4, bright 8) nearest to an rgb() color
+        inline int nearest_ansi(int color) {
+            int red = (color >> 16) & 0xFF;
+            int green = (color >> 8) & 0xFF;
+            int blue = color & 0xFF;
+            int brightest = std::max(red, std::max(green, blue));
+            int threshold = std::max(brightest / 2, 48);
+            return (
+                (red >= threshold ? 1 : 0) |
+                (green >= threshold ? 2 : 0) |
+                (blue >= threshold ? 4 : 0) |
+                (brightest >= 192 ? 8 : 0)
+            );
+        }
+
+        // True if Target can write a run of characters in one style with put_text()
+        template<typename Target, typename = void>
+        struct has_put_text : std::false_type {};
+
+        template<typename Target>
+        struct has_put_text<Target, std::void_t<decltype(std::declval<Target &>().put_text(0, 0, "", 0, (short)0))> > : std::true_type {};
+    }
+
+    // Styles of the cells of a window or surface
+    // Cells store a style id. Ids below 256 are styles of two of the first 16 colors
+    // without attributes, equal to get_color(foreground, background), and mean the
+    // same in every table. Other styles get the next free id when first interned.
+    class StyleTable {
+        public:
+            static constexpr int plain_styles = 256;
+            static constexpr int capacity = 32768;
+
+            // Return true if style has a fixed id
+            static inline bool is_plain(const Style &style) {
+                return (
+                    style.attributes == ATTR_NONE &&
+                    style.foreground >= 0 && style.foreground < 16 &&
+                    style.background >= 0 && style.background < 16
                 );
-                for(int i = widget.y; i < widget.y + widget.height; i++) {
-                    for(int j = widget.x; j < widget.x + widget.width; j++) {
-                        if(
-                            (i == widget.y && j == widget.x) || 
-                            (i == widget.y && j == (widget.x + widget.width) - 1) ||
-                            (i == (widget.y + widget.height) - 1 && j == widget.x) ||
-                            (i == (widget.y + widget.height) - 1 && j == (widget.x + widget.width) - 1)) {
-                            draw_char(j, i, '+', border_color);
-                        } else if(i == widget.y || i == (widget.y + widget.height) - 1) {
-                            draw_char(j, i, '-', border_color);
-                        } else if(j == widget.x || j == (widget.x + widget.width) - 1) {
-                            draw_char(j, i, '|', border_color);
-                        }
-                    }
-                }
             }
 
-            // Draw title
-            template<typename Widget>
-            void draw_title(Widget widget) {
-                short title_color = get_color(
-                    widget.title_style.foreground, 
-                    widget.title_style.background
+            // Return the id of style, adding it to the table if needed
+            short intern(const Style &style) {
+                if(is_plain(style)) {
+                    return get_color(style.foreground, style.background);
+                }
+                uint64_t key = (
+                    ((uint64_t)(style.foreground & 0x1FFFFFF) << 39) |
+                    ((uint64_t)(style.background & 0x1FFFFFF) << 14) |
+                    (uint64_t)(style.attributes & 0x3FFF)
                 );
-                for(int i = widget.x + 2; i < widget.x + std::min(widget.width, (int)(widget.title.length()) + 2); i++) {
-                    draw_char(i, widget.y, widget.title[i - (widget.x + 2)], title_color);
+                auto found = ids.find(key);
+                if(found != ids.end()) {
+                    return found->second;
                 }
+                if(size() >= capacity) {
+                    // Painting must not fail, a full table draws new styles in the nearest plain style
+                    return nearest_plain(style);
+                }
+                short id = (short)size();
+                styles.push_back(style);
+                ids.emplace(key, id);
+                return id;
             }
 
-            // Add a widget to the window 
-            // using recursive template function
-            template<typename Widget, typename ... Rest>
-            inline void add(Widget first, Rest... rest) {
-                add(first);
-                add(rest...);
+            // Return the id of the plain style nearest to style, dropping its attributes
+            static inline short nearest_plain(const Style &style) {
+                auto nearest = [](int color, int fallback) {
+                    if(color >= 16 && color < 256) {
+                        color = detail::palette_rgb(color);
+                    }
+                    if(color >= 256) {
+                        return detail::nearest_ansi(color);
+                    }
+                    return (color >= 0 && color < 16) ? color : fallback;
+                };
+                return get_color(nearest(style.foreground, WHITE), nearest(style.background, BLACK));
             }
 
-#ifdef IS_WIN
-            Window(int window_width_ = 0, int window_height_ = 0) : window_width((LONG)window_width_), window_height((LONG)window_height_) {
-                // Resize console to window_width and window_height
-                console = GetConsoleWindow();
-                // Get default dimensions
-                default_width = width();
-                default_height = height();
-                // Check if no width and height was given
-                if(window_width_ <= 0 || window_height_ < 0) {
-                    // Window width or height given is 0 or less
-                    // Use default dimensions
-                    window_width = default_width;
-                    window_height = default_height;
-                }
-                RECT r;
-                GetWindowRect(console, &r);
-                MoveWindow(console, r.left, r.top, window_width, window_height, TRUE);
-                // Tidy up the window
-                hide_cursor();
-                remove_scrollbar();
-                update_dimensions();
-                // Allocate memory for content
-                content = new CHAR_INFO[columns_ * rows_];
-                memset(content, 0, sizeof(CHAR_INFO) * rows_ * columns_);
+            // Return the style of a plain style id
+            static inline Style plain_style(short id) {
+                return {id & 0xF, (id >> 4) & 0xF, ATTR_NONE};
             }
 
-            // Close the tui and revert to default settings
-            void close() {
-                clear();
-                // Render the cleared content
-                render();
-                // Show the cursor
-                show_cursor();
-                RECT r;
-                GetWindowRect(console, &r);
-                MoveWindow(console, r.left, r.top, default_width, default_height, TRUE);
+            // Return the style of id, the default style for unknown ids
+            Style get(short id) const {
+                if(id >= 0 && id < plain_styles) {
+                    return plain_style(id);
+                }
+                if(id >= plain_styles && id < size()) {
+                    return styles[id - plain_styles];
+                }
+                return Style{};
             }
 
-            // Remove scrollbar from console
-            void remove_scrollbar() {
-                GetConsoleScreenBufferInfo(handle, &csbi);
-                COORD new_size = {
-                    (short)(csbi.srWindow.Right - csbi.srWindow.Left + 1),
-                    (short)(csbi.srWindow.Bottom - csbi.srWindow.Top + 1)
-                };
-                SetConsoleScreenBufferSize(handle, new_size);
+            // Return the id of style id of other in this table
+            inline short import(const StyleTable &other, short id) {
+                return (id >= 0 && id < plain_styles) ? id : intern(other.get(id));
             }
 
-            // Clear content
-            inline void clear() { 
-                // Set content to ' '
-                memset(content, 0, sizeof(CHAR_INFO) * rows_ * columns_);
+            // Return one more than the largest id
+            inline int size() const {
+                return plain_styles + (int)styles.size();
             }
 
-            // Hide cursor from console
-            void hide_cursor() {
-                CONSOLE_CURSOR_INFO info;
-                info.bVisible = FALSE;
-                info.dwSize = 100;
-                SetConsoleCursorInfo(handle, &info);
-            }
+        private:
+            std::vector<Style> styles; // Styles from id plain_styles on
+            std::unordered_map<uint64_t, short> ids;
+    };
 
-            // Show cursor from console
-            void show_cursor() {
-                CONSOLE_CURSOR_INFO info;
-                info.bVisible = TRUE;
-                SetConsoleCursorInfo(handle, &info);
-            }
+    // Drawing area of a target clipped to a rectangle
+    // Widgets compute their loop ranges from clip once and write with put(),
+    // which does not check bounds. Targets provide put(x, y, c, color) and
+    // put_color(x, y, color) for cells known to be inside the target.
+    // Colors are style ids of styles, targets without a style table only get plain styles.
+    template<typename Target>
+    struct DrawContext {
+        Target *target;
+        Rect clip;
+        StyleTable *styles;
 
-            // Return width of window
-            LONG width() {
-                RECT r;
-                GetWindowRect(console, &r);
-                return r.right - r.left;
-            }
+        DrawContext(Target &target_, const Rect &clip_, StyleTable *styles_ = nullptr) : target(&target_), clip(clip_), styles(styles_) {}
 
-            // Return height of window
-            LONG height() {
-                RECT r;
-                GetWindowRect(console, &r);
-                return r.bottom - r.top;
+        // Return a context further clipped to rect
+        inline DrawContext clipped(const Rect &rect) const {
+            return DrawContext(*target, clip.intersect(rect), styles);
+        }
+
+        // Return the style id of style
+        inline short style(const Style &style) const {
+            if(styles != nullptr) {
+                return styles->intern(style);
             }
+            return get_color(style.foreground & 0xF, style.background & 0xF);
+        }
 
-            // Return number of columns
-            short columns() {
-                GetConsoleScreenBufferInfo(handle, &csbi);
-                return csbi.srWindow.Right - csbi.srWindow.Left;
+        inline int left() const {
+            return clip.x;
+        }
+
+        inline int right() const {
+            return clip.x + clip.width;
+        }
+
+        inline int top() const {
+            return clip.y;
+        }
+
+        inline int bottom() const {
+            return clip.y + clip.height;
+        }
+
+        inline bool contains(int x, int y) const {
+            return x >= left() && x < right() && y >= top() && y < bottom();
+        }
+
+        // Write a cell inside clip
+        inline void put(int x, int y, char c, short color) {
+            target->put(x, y, c, color);
+        }
+
+        // Set color of a cell inside clip
+        inline void put_color(int x, int y, short color) {
+            target->put_color(x, y, color);
+        }
+
+        // Write count characters of text in one style from x, all inside clip
+        inline void put_text(int x, int y, const char *text, int count, short color) {
+            if constexpr(detail::has_put_text<Target>::value) {
+                target->put_text(x, y, text, count, color);
+            } else {
+                for(int i = 0; i < count; i++) {
+                    target->put(x + i, y, text[i], color);
+                }
             }
+        }
 
-            // Return number of rows
-            short rows() {
-                GetConsoleScreenBufferInfo(handle, &csbi);
-                return csbi.srWindow.Bottom - csbi.srWindow.Top;
+        // Write a cell if it is inside clip
+        inline void draw_char(int x, int y, char c, short color = 0x000F) {
+            if(contains(x, y)) {
+                put(x, y, c, color);
             }
+        }
 
-            // Set window title
-            void set_title(std::string str) {
-                TCHAR new_title[MAX_PATH];
-                new_title[str.size()] = 0;
-                std::copy(str.begin(), str.end(), new_title);
-                SetConsoleTitle(new_title);
+        // Set color of a cell if it is inside clip
+        inline void draw_color(int x, int y, short color) {
+            if(contains(x, y)) {
+                put_color(x, y, color);
             }
+        }
+    };
 
-            // Set character in content
-            void draw_char(int x, int y, char c, short color = 0x000F) {
-                if(x >= 0 && x < columns_ && y >= 0 && y < rows_) {
-                    content[y * columns_ + x].Char.AsciiChar = c;
-                    content[y * columns_ + x].Attributes = color;
+    // Fuzzy matching
+    // A query matches text if its characters appear in text in order, ignoring ASCII case.
+    namespace detail {
+        inline char fold_case(char c) {
+            return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+        }
+
+        // Return a bit for every class of character in text
+        // Letters and digits have a bit each, other characters share the remaining bits.
+        // A query can only match text whose mask contains every bit of the query mask
+        inline uint64_t fuzzy_mask(const char *text, size_t length) {
+            uint64_t mask = 0;
+            for(size_t i = 0; i < length; i++) {
+                unsigned char c = fold_case(text[i]);
+                int bit;
+                if(c >= 'a' && c <= 'z') {
+                    bit = c - 'a';
+                } else if(c >= '0' && c <= '9') {
+                    bit = 26 + (c - '0');
+                } else if(c < 128) {
+                    bit = 36 + c % 27;
+                } else {
+                    bit = 63;
                 }
+                mask |= (uint64_t)1 << bit;
             }
+            return mask;
+        }
 
-            // Render (print) content
-            void render() {
-                SMALL_RECT sr = {0, 0, (short)(columns_ - 1), (short)(rows_ - 1)};
-                hide_cursor();
-                remove_scrollbar();
-                WriteConsoleOutput(handle, content, {columns_, rows_}, {0, 0}, &sr);
-            }
+        inline bool is_word_separator(char c) {
+            return c == ' ' || c == '.' || c == '-' || c == '_' || c == '/' || c == ':';
+        }
 
-            // Poll for event
-            bool poll_event(Event &event) {
-                event = Event{};
-                for(uint8_t k = VK_LBUTTON; k <= VK_OEM_CLEAR; k++) {
-                    if(GetKeyState(k) & 0x8000) {
-                        if(k >= VK_LBUTTON && k <= VK_XBUTTON2 && k != VK_CANCEL) {
-                            event.type = MOUSEBUTTONDOWN;
-                        } else {
-                            event.type = KEYDOWN;
-                        }
-                        event.key = tolower(k);
-                        // Wait for key unpress
-                        while(GetKeyState(k) & 0x8000);
-                    }
-                }
-                if(event.type != UNDEFINED) {
-                    // Event has been registered
-                    return true;
-                } else {
-                    return false;
-                }
-            }
-
-            // Return the content of the buffer
-            inline CHAR_INFO * get_content() {
-                return content;
-            }
-#elif defined(IS_POSIX)
-            Window() {
-                initscr();
-                raw();
-                keypad(stdscr, TRUE);
-                noecho();
-                start_color();
-                hide_cursor();
-                update_dimensions();
-                timeout(1);
-            }
-
-            // Close the tui and revert to default settings
-            void close() {
-                show_cursor();
-                endwin();
-            }
-
-            // Remove scrollbar from console (no op)
-            inline void remove_scrollbar() { };
-
-            // Clear content (no op)
-            inline void clear() { };
-
-            // Hide cursor from console
-            inline void hide_cursor() {
-                curs_set(0);
-            }
-
-            // Show cursor from console
-            inline void show_cursor() {
-                curs_set(1);
+        // Match query, which must be case folded, against text
+        // The shortest match ending at the first possible position is scored:
+        // every character scores, consecutive characters and word starts score more
+        // and skipped characters cost. Positions of matched characters are written
+        // to positions if it is not null, it needs room for query_length values.
+        inline bool fuzzy_match(const char *text, int length, const char *query, int query_length, int &score, int *positions = nullptr) {
+            score = 0;
+            if(query_length == 0) {
+                return true;
             }
-
-            // Return width of window
-            short width() {
-                struct winsize size;
-                ioctl(STDOUT_FILENO, TIOCGWINSZ, &size);
-                return size.ws_xpixel;
+            int matched = 0;
+            int end = -1;
+            for(int i = 0; i < length; i++) {
+                if(fold_case(text[i]) == query[matched] && ++matched == query_length) {
+                    end = i;
+                    break;
+                }
             }
-
-            // Return height of window
-            short height() {
-                struct winsize size;
-                ioctl(STDOUT_FILENO, TIOCGWINSZ, &size);
-                return size.ws_ypixel;
+            if(end < 0) {
+                return false;
             }
-
-            // Return number of columns
-            short columns() {
-                struct winsize size;
-                ioctl(STDOUT_FILENO, TIOCGWINSZ, &size);
-                return size.ws_col;
+            // Walk back to the latest start of a match ending at end
+            int start = end;
+            matched = query_length - 1;
+            for(int i = end; i >= 0; i--) {
+                if(fold_case(text[i]) == query[matched] && --matched < 0) {
+                    start = i;
+                    break;
+                }
             }
-
-            // Return number of rows
-            short rows() {
-                struct winsize size;
-                ioctl(STDOUT_FILENO, TIOCGWINSZ, &size);
-                return size.ws_row;
+            matched = 0;
+            int previous = -2;
+            for(int i = start; i <= end && matched < query_length; i++) {
+                if(fold_case(text[i]) == query[matched]) {
+                    score += 16;
+                    if(i == previous + 1) {
+                        score += 8;
+                    }
+                    if(i == 0 || is_word_separator(text[i - 1])) {
+                        score += 8;
+                    }
+                    if(positions != nullptr) {
+                        positions[matched] = i;
+                    }
+                    previous = i;
+                    matched++;
+                } else {
+                    score -= 1;
+                }
             }
+            return true;
+        }
+    }
 
-            // Set window title (no op)
-            inline void set_title(std::string str){ };
+    // Widget rasterization
+    // Each widget is drawn into a context which is already clipped to its rectangle
 
-            // Set character in tui
-            inline void draw_char(int x, int y, char c, short color = 0x000F) {
-                // TODO: Add color functionality
-                mvaddch(y, x, c);
+    // Draw border with given widget dimensions
+    template<typename Target, typename Widget>
+    void paint_border(DrawContext<Target> &context, const Widget &widget) {
+        short border_color = context.style(widget.border_style);
+        int left = widget.x;
+        int right = widget.x + widget.width - 1;
+        int top = widget.y;
+        int bottom = widget.y + widget.height - 1;
+        int first_column = std::max(left, context.left());
+        int last_column = std::min(right + 1, context.right());
+        auto draw_edge = [&](int row) {
+            if(row >= context.top() && row < context.bottom()) {
+                for(int j = first_column; j < last_column; j++) {
+                    context.put(j, row, (j == left || j == right) ? '+' : '-', border_color);
+                }
             }
-
-            // Render tui
-            inline void render() {
-                refresh();
+        };
+        draw_edge(top);
+        if(bottom != top) {
+            draw_edge(bottom);
+        }
+        bool draw_left = left >= context.left() && left < context.right();
+        bool draw_right = right != left && right >= context.left() && right < context.right();
+        int last_row = std::min(bottom, context.bottom());
+        for(int i = std::max(top + 1, context.top()); i < last_row; i++) {
+            if(draw_left) {
+                context.put(left, i, '|', border_color);
             }
-
-            // Poll for event
-            bool poll_event(Event &event) {
-                event.key = 0;
-                event.type = UNDEFINED;
-                int ch;
-                ch = getch();
-                if(ch != EOF) {
-                    if(ch == KEY_MOUSE) {
-                        return false;
-                    } else {
-                        event.type = KEYDOWN;
-                        event.key = ch;
-                    }
-                    return true;
-                }
-                return false;
+            if(draw_right) {
+                context.put(right, i, '|', border_color);
             }
+        }
+    }
 
-            // Return the content of the buffer (no op)
-            inline void get_content(){ };
-#endif
-        private:
-#ifdef IS_WIN
-            HANDLE handle = GetStdHandle(STD_OUTPUT_HANDLE);
-            CONSOLE_SCREEN_BUFFER_INFO csbi;
-            HWND console;
-            LONG window_width; // Width of window
-            LONG window_height; // Height of window
-            short columns_;
-            short rows_;
-            CHAR_INFO *content; // Content to be rendered to buffer
-            LONG default_width; // Width of the window before tui started
-            LONG default_height; // Height of the window before tui started
-#elif defined(IS_POSIX)
-            short window_width;
-            short window_height;
-            short columns_;
-            short rows_;
-            int current_pair = 1;
-#endif
-    };
+    // Draw title
+    template<typename Target, typename Widget>
+    void paint_title(DrawContext<Target> &context, const Widget &widget) {
+        if(widget.y < context.top() || widget.y >= context.bottom()) {
+            return;
+        }
+        short title_color = context.style(widget.title_style);
+        int first_column = std::max(widget.x + 2, context.left());
+        int last_column = std::min(widget.x + std::min(widget.width, (int)(widget.title.length()) + 2), context.right());
+        for(int i = first_column; i < last_column; i++) {
+            context.put(i, widget.y, widget.title[i - (widget.x + 2)], title_color);
+        }
+    }
 
-    // Widget add to window method definitions
-    template<>
-    void Window::add(Paragraph paragraph) {
+    template<typename Target>
+    void paint(DrawContext<Target> &context, const Paragraph &paragraph) {
         if(paragraph.border == true) {
-            draw_border(paragraph);
+            paint_border(context, paragraph);
         }
         if(paragraph.title.empty() == false) {
-            draw_title(paragraph);
+            paint_title(context, paragraph);
         }
         // Get color
-        short text_color = get_color(
-            paragraph.text_style.foreground, 
-            paragraph.text_style.background
-        );
+        short text_color = context.style(paragraph.text_style);
         // Draw text
-        int maximum_characters = (paragraph.width - 2) * (paragraph.height - 2);
-        for(int i = paragraph.y + 1; i < paragraph.y + paragraph.height - 1; i++) {
-            int current_row = i - (paragraph.y + 1);
-            for(int j = paragraph.x + 1; j < paragraph.x + paragraph.width - 1; j++) {
-                int current_column = j - (paragraph.x + 1);
-                int current_index = (current_row * (paragraph.width - 2)) + current_column;
-                if(current_index < paragraph.text.length()) {
-                    draw_char(j, i, paragraph.text[current_index], text_color);
-                } else {
-                    // Paragraph text is shorter than maximum characters
-                    break;
+        int inner_width = paragraph.width - 2;
+        int length = paragraph.text.length();
+        int maximum_characters = inner_width * (paragraph.height - 2);
+        int first_column = std::max(paragraph.x + 1, context.left());
+        int last_column = std::min(paragraph.x + paragraph.width - 1, context.right());
+        int last_row = std::min(paragraph.y + paragraph.height - 1, context.bottom());
+        const std::vector<TextSpan> &spans = paragraph.spans;
+        for(int i = std::max(paragraph.y + 1, context.top()); i < last_row; i++) {
+            int row_start = (i - (paragraph.y + 1)) * inner_width;
+            // Paragraph text may end before the end of the row
+            int end_column = std::min(last_column, paragraph.x + 1 + (length - row_start));
+            int start = row_start + first_column - (paragraph.x + 1);
+            int end = row_start + end_column - (paragraph.x + 1);
+            // First span ending after the start of the row
+            auto span = std::partition_point(spans.begin(), spans.end(), [&](const TextSpan &current) {
+                return (int64_t)current.offset + current.length <= start;
+            });
+            // Write runs of one style at once, the style of a span is looked up once per row
+            for(int position = start; position < end;) {
+                // Overlapping spans are cut by earlier ones
+                while(span != spans.end() && (int64_t)span->offset + span->length <= position) {
+                    span++;
                 }
+                int run_end = end;
+                short color = text_color;
+                if(span != spans.end() && (int)span->offset <= position) {
+                    run_end = std::min<int64_t>(end, (int64_t)span->offset + span->length);
+                    color = context.style(span->style);
+                    span++;
+                } else if(span != spans.end()) {
+                    run_end = std::min(end, (int)span->offset);
+                }
+                context.put_text(
+                    paragraph.x + 1 + position - row_start, i,
+                    paragraph.text.data() + position, run_end - position, color
+                );
+                position = run_end;
             }
         }
-        if(paragraph.text.length() > maximum_characters && paragraph.width - 2 >= 3) {
+        if(length > maximum_characters && inner_width >= 3) {
             // Draw ellipsis
-            int last_row = (paragraph.y + paragraph.height) - 2;
+            int ellipsis_row = (paragraph.y + paragraph.height) - 2;
             for(int i = 0; i < 3; i++) {
                 int current_column = ((paragraph.x + paragraph.width) - 2) - i;
-                draw_char(current_column, last_row, '.', text_color);
+                context.draw_char(current_column, ellipsis_row, '.', text_color);
             }
         }
     }
 
-    template<>
-    void Window::add(List list) {
-        if(list.border == true) {
-            draw_border(list);
-        }
-        if(list.title.empty() == false) {
-            draw_title(list);
-        }
+    // Draw rows first_row to last_row (exclusive) of the inner area of list
+    template<typename Target>
+    void paint_list_rows(DrawContext<Target> &context, const List &list, int first_row, int last_row) {
         // Get color
-        short text_color = get_color(
-            list.text_style.foreground, 
-            list.text_style.background
-        );
-        for(int i = list.y + 1; i < list.y + list.height - 1; i++) {
+        short text_color = context.style(list.text_style);
+        short highlight_color = context.style(list.highlight_style);
+        short selected_color = context.style(list.selected_style);
+        short hover_color = context.style(list.hover_style);
+        int inner_width = list.width - 2;
+        int first_column = std::max(list.x + 1, context.left());
+        int last_column = std::min(list.x + list.width - 1, context.right());
+        int bottom = std::min(list.y + 1 + last_row, context.bottom());
+        std::string query;
+        for(char c : list.highlight) {
+            query += detail::fold_case(c);
+        }
+        std::vector<int> positions(query.length());
+        for(int i = std::max(list.y + 1 + first_row, context.top()); i < bottom; i++) {
             // Calculate current row with list's first element
             int current_row = list.first_element + (i - (list.y + 1));
-            for(int j = list.x + 1; j < list.x + list.width - 1; j++) {
+            const std::string *row = nullptr;
+            if(current_row >= 0 && current_row < (int)list.visible_size()) {
+                row = &list.rows[list.view ? (*list.view)[current_row] : current_row];
+            }
+            int length = row != nullptr ? row->length() : 0;
+            // Selected and hovered rows are filled across the whole width
+            short row_color = text_color;
+            short blank_color = 0x000F;
+            if(row != nullptr && (current_row == list.selected || current_row == list.hovered)) {
+                row_color = blank_color = current_row == list.selected ? selected_color : hover_color;
+            }
+            // Only rows in view are matched again to find highlighted characters
+            int score;
+            size_t next_position = positions.size();
+            if(row != nullptr && !query.empty() && detail::fuzzy_match(row->c_str(), length, query.c_str(), query.length(), score, positions.data())) {
+                next_position = 0;
+            }
+            for(int j = first_column; j < last_column; j++) {
                 int current_column = j - (list.x + 1);
                 // Naively assume character is empty
-                draw_char(j, i, ' ');
-                if(current_row < list.rows.size() && current_column < list.rows[current_row].length()) {
-                    if(list.rows[current_row].length() > list.width - 2 && j >= (list.x + list.width - 4)) {
+                char c = ' ';
+                short color = blank_color;
+                if(current_column < length) {
+                    if(length > inner_width && j >= (list.x + list.width - 4)) {
                         // Draw ellipsis
-                        if(list.width - 2 >= 3) {
+                        if(inner_width >= 3) {
                             // Only draw ellipsis if inner width is at least 3
-                            draw_char(j, i, '.', text_color);
+                            c = '.';
+                            color = row_color;
                         }
                     } else {
-                        draw_char(j, i, list.rows[current_row][current_column], text_color);
+                        c = (*row)[current_column];
+                        color = row_color;
+                        while(next_position < positions.size() && positions[next_position] < current_column) {
+                            next_position++;
+                        }
+                        if(next_position < positions.size() && positions[next_position] == current_column) {
+                            color = highlight_color;
+                        }
                     }
                 }
+                context.put(j, i, c, color);
             }
         }
     }
 
-    template<>
-    void Window::add(BarChart bar_chart) {
-        if(bar_chart.border == true) {
-            draw_border(bar_chart);
+    template<typename Target>
+    void paint(DrawContext<Target> &context, const List &list) {
+        if(list.border == true) {
+            paint_border(context, list);
         }
-        if(bar_chart.title.empty() == false) {
-            draw_title(bar_chart);
+        if(list.title.empty() == false) {
+            paint_title(context, list);
         }
-        // Get colors
-        short label_color = get_color(
-            bar_chart.label_style.foreground, 
-            bar_chart.label_style.background
-        );
-        short number_color = get_color(
-            bar_chart.number_style.foreground, 
-            bar_chart.number_style.background
-        );
-        // Get minimum and maximum values
-        int minimum = INT_MAX;
-        int maximum = INT_MIN;
-        for(int i = 0; i < bar_chart.data.size(); i++) {
-            if(bar_chart.data[i] < minimum) {
-                minimum = bar_chart.data[i];
+        paint_list_rows(context, list, 0, list.height - 2);
+    }
+
+    // What a widget showed when it was last drawn, so later draws can skip what did not change
+    struct PaintState {
+        uint64_t layout = 0;     // Hash of everything drawn except the values, 0 before the first draw
+        std::vector<int> values; // Values drawn, e.g. the bar width of a gauge
+    };
+
+    namespace detail {
+        // Return a hash of the position, clip, border, styles and title of widget, never 0
+        template<typename Target>
+        uint64_t layout_hash(const DrawContext<Target> &context, const Widget &widget) {
+            const int64_t values[] = {
+                widget.x, widget.y, widget.width, widget.height, widget.border,
+                context.clip.x, context.clip.y, context.clip.width, context.clip.height,
+                widget.border_style.foreground, widget.border_style.background, widget.border_style.attributes,
+                widget.text_style.foreground, widget.text_style.background, widget.text_style.attributes,
+                widget.title_style.foreground, widget.title_style.background, widget.title_style.attributes,
+                (int64_t)std::hash<std::string>()(widget.title)
+            };
+            uint64_t hash = 1;
+            for(int64_t value : values) {
+                hash = hash_combine(hash, value);
+            }
+            return hash | 1;
+        }
+
+        // Height in rows of every bar of bar_chart, against the largest value
+        inline void bar_heights(const BarChart &bar_chart, std::vector<int> &heights) {
+            int maximum = INT_MIN;
+            for(int value : bar_chart.data) {
+                maximum = std::max(maximum, value);
+            }
+            heights.resize(bar_chart.data.size());
+            for(size_t i = 0; i < bar_chart.data.size(); i++) {
+                // All zero data, e.g. an empty histogram, has no bars
+                float normalized = maximum > 0 ? (floor)(bar_chart.data[i]) / (maximum) : 0;
+                heights[i] = floor(normalized * (bar_chart.height - 3));
             }
-            if(bar_chart.data[i] > maximum) {
-                maximum = bar_chart.data[i];
+        }
+    }
+
+    // Draw rows first_row to last_row (exclusive) of the bar area of bar number bar at column left
+    // A bar of height h fills h - 1 rows, cells above it are blanked and the value is drawn on the bottom row
+    template<typename Target>
+    void paint_bar_rows(DrawContext<Target> &context, const BarChart &bar_chart, int bar, int left, int height, int first_row, int last_row) {
+        short number_color = context.style(bar_chart.number_style);
+        short bar_color = context.style({bar_chart.number_style.foreground, bar_chart.bar_color, bar_chart.number_style.attributes});
+        std::string number = std::to_string(bar_chart.data[bar]);
+        int inner_right = bar_chart.x + bar_chart.width - 1;
+        int number_row = bar_chart.y + bar_chart.height - 3;
+        int bar_top = number_row + 2 - height;
+        int first_column = std::max(left, context.left());
+        int last_column = std::min(left + bar_chart.bar_width, context.right());
+        first_row = std::max(first_row, std::max(bar_chart.y + 1, context.top()));
+        last_row = std::min(last_row, std::min(number_row + 1, context.bottom()));
+        for(int y = first_row; y < last_row; y++) {
+            for(int x = first_column; x < last_column; x++) {
+                bool in_bar = y >= bar_top;
+                bool in_number = y == number_row && x - left < (int)number.length() && x < inner_right;
+                char glyph = in_number ? number[x - left] : ' ';
+#ifdef IS_WIN
+                // Numbers take the background of the bar
+                short color = in_bar ? bar_color : (in_number ? number_color : 0x000F);
+#elif defined(IS_POSIX)
+                // Numbers are drawn over the bar
+                short color = in_number ? number_color : (in_bar ? bar_color : 0x000F);
+                if(in_bar && !in_number) {
+                    glyph = '#';
+                }
+#endif
+                context.put(x, y, glyph, color);
             }
         }
+    }
+
+    template<typename Target>
+    void paint(DrawContext<Target> &context, const BarChart &bar_chart) {
+        if(bar_chart.border == true) {
+            paint_border(context, bar_chart);
+        }
+        if(bar_chart.title.empty() == false) {
+            paint_title(context, bar_chart);
+        }
+        // Get colors
+        short label_color = context.style(bar_chart.label_style);
+        static thread_local std::vector<int> heights;
+        detail::bar_heights(bar_chart, heights);
         // Draw
+        int inner_right = bar_chart.x + bar_chart.width - 1;
         int current_bar = 0;
-        int current_character = 0;
-        for(int i = bar_chart.x + 1; i < bar_chart.x + bar_chart.width - 1; i += bar_chart.bar_width + 1) {
+        for(int i = bar_chart.x + 1; i < inner_right; i += bar_chart.bar_width + 1) {
             if(current_bar < bar_chart.labels.size()) {
+                const std::string &label = bar_chart.labels[current_bar];
                 for(int j = 0; j < bar_chart.bar_width; j++) {
-                    if(j < bar_chart.labels[current_bar].size() && i + j < bar_chart.x + bar_chart.width - 1) {
-                        draw_char(
+                    if(j < label.size() && i + j < inner_right) {
+                        context.draw_char(
                             (i + j), 
                             (bar_chart.y + bar_chart.height - 2),
-                            bar_chart.labels[current_bar][j],
+                            label[j],
                             label_color
                         );
                     }
                 }
             }
             if(current_bar < bar_chart.data.size()) {
-                auto draw_numbers = [&]() {
-                    for(int j = 0; j < bar_chart.bar_width; j++) {
-                        std::string current_number = std::to_string(bar_chart.data[current_bar]);
-                        if(j < current_number.length() && i + j < bar_chart.x + bar_chart.width - 1) {
-                            draw_char(
-                                (i + j),
-                                (bar_chart.y + bar_chart.height - 3),
-                                current_number[j],
-                                number_color
-                            );
-                        }
-                    }
-                };
-
-#ifdef IS_WIN
-                // If defined IS_WIN, draw numbers before bars
-                draw_numbers();
-#endif
-                float normalized = (floor)(bar_chart.data[current_bar]) / (maximum);
-                int maximum_height = bar_chart.height - 3;
-                int height = floor(normalized * maximum_height);
-                for(int y = bar_chart.y + maximum_height - height + 2; y < bar_chart.y + maximum_height + 1; y++) {
-                    for(int x = 0; x < bar_chart.bar_width; x++) {
-#ifdef IS_WIN
-                            // Skip draw char to avoid overriding char
-                            content[y * columns_ + (i + x)].Attributes = get_color(
-                                number_color,
-                                bar_chart.bar_color
-                            );
-#elif defined(IS_POSIX)
-                            draw_char(
-                                (i + x),
-                                y,
-                                '#',
-                                get_color(number_color, bar_chart.bar_color)
-                            );
-#endif
-                    }
-                }
-#ifdef IS_POSIX
-            // If defined IS_POSIX, draw numbers after bars
-            draw_numbers();
-#endif
+                paint_bar_rows(context, bar_chart, current_bar, i, heights[current_bar], bar_chart.y + 1, bar_chart.y + bar_chart.height - 2);
             }
             current_bar++;
         }
     }
 
-    template<>
-    void Window::add(Gauge gauge) {
-        if(gauge.border == true) {
-            draw_border(gauge);
+    // Draw bar_chart, or only the bars whose value or height changed since state was drawn
+    // The cells of the chart must still show state
+    template<typename Target>
+    void paint_changes(DrawContext<Target> &context, const BarChart &bar_chart, PaintState &state) {
+        uint64_t layout = detail::layout_hash(context, bar_chart);
+        const int64_t values[] = {
+            bar_chart.bar_width, bar_chart.bar_color, (int64_t)bar_chart.data.size(),
+            bar_chart.label_style.foreground, bar_chart.label_style.background, bar_chart.label_style.attributes,
+            bar_chart.number_style.foreground, bar_chart.number_style.background, bar_chart.number_style.attributes
+        };
+        for(int64_t value : values) {
+            layout = detail::hash_combine(layout, value);
         }
-        if(gauge.title.empty() == false) {
-            draw_title(gauge);
+        for(const std::string &label : bar_chart.labels) {
+            layout = detail::hash_combine(layout, std::hash<std::string>()(label));
         }
+        layout |= 1;
+        static thread_local std::vector<int> heights;
+        detail::bar_heights(bar_chart, heights);
+        size_t bars = bar_chart.data.size();
+        if(layout != state.layout || state.values.size() != 2 * bars) {
+            paint(context, bar_chart);
+        } else {
+            int number_row = bar_chart.y + bar_chart.height - 3;
+            int inner_right = bar_chart.x + bar_chart.width - 1;
+            size_t bar = 0;
+            for(int i = bar_chart.x + 1; i < inner_right && bar < bars; i += bar_chart.bar_width + 1, bar++) {
+                int old_value = state.values[2 * bar];
+                int old_height = state.values[2 * bar + 1];
+                if(old_height != heights[bar]) {
+                    // Only the rows between the old and the new top of the bar
+                    int old_top = number_row + 2 - old_height;
+                    int new_top = number_row + 2 - heights[bar];
+                    paint_bar_rows(context, bar_chart, (int)bar, i, heights[bar], std::min(old_top, new_top), std::max(old_top, new_top));
+                }
+                if(old_value != bar_chart.data[bar]) {
+                    paint_bar_rows(context, bar_chart, (int)bar, i, heights[bar], number_row, number_row + 1);
+                }
+            }
+        }
+        state.layout = layout;
+        state.values.resize(2 * bars);
+        for(size_t bar = 0; bar < bars; bar++) {
+            state.values[2 * bar] = bar_chart.data[bar];
+            state.values[2 * bar + 1] = heights[bar];
+        }
+    }
+
+    // Draw inner columns first to last (exclusive) of gauge with a bar of bar_width columns
+    template<typename Target>
+    void paint_gauge_columns(DrawContext<Target> &context, const Gauge &gauge, int bar_width, int first, int last) {
         // Get color
-        short label_color = get_color(
-            gauge.label_style.foreground, 
-            gauge.label_style.background
-        );
-        // Draw bar
-        int bar_width = floor(((float)gauge.percent / 100) * (gauge.width - 2));
-        for(int i = gauge.y + 1; i < gauge.y + gauge.height - 1; i++) {
-            for(int j = gauge.x + 1; j < gauge.x + gauge.width - 1; j++) {
-                // Naively assume character is empty
-                draw_char(j, i, ' ');
-                if((j - (gauge.x + 1)) < bar_width) {
+        short label_color = context.style(gauge.label_style);
+        short bar_color = context.style({gauge.label_style.foreground, gauge.bar_color});
+        short label_bar_color = context.style({gauge.label_style.foreground, gauge.bar_color, gauge.label_style.attributes});
+        // Draw bar, cells under the label are drawn with the label
+        int label_y = gauge.y + floor(gauge.height / 2);
+        int label_end = gauge.x + 1 + std::min((int)gauge.label.length(), gauge.width - 2);
+        int first_column = std::max(gauge.x + 1 + first, context.left());
+        int last_column = std::min(gauge.x + 1 + last, std::min(gauge.x + gauge.width - 1, context.right()));
+        int last_row = std::min(gauge.y + gauge.height - 1, context.bottom());
+        for(int i = std::max(gauge.y + 1, context.top()); i < last_row; i++) {
+            for(int j = (i == label_y ? std::max(first_column, label_end) : first_column); j < last_column; j++) {
+                bool in_bar = (j - (gauge.x + 1)) < bar_width;
 #ifdef IS_WIN
-                    content[(i * columns_) + j].Attributes = get_color(
-                        gauge.label_style.foreground,
-                        gauge.bar_color
-                    );
+                context.put(j, i, ' ', in_bar ? bar_color : 0x000F);
 #elif defined(IS_POSIX)
-                    draw_char(
-                        j,
-                        i,
-                        '#',
-                        get_color(gauge.label_style.foreground, gauge.bar_color)
-                    );
+                context.put(j, i, in_bar ? '#' : ' ', in_bar ? bar_color : 0x000F);
 #endif
-                }
             }
         }
         // Draw label
-        int label_y = gauge.y + floor(gauge.height / 2);
-        int current_char = 0;
-        for(int i = gauge.x + 1; i < gauge.x + gauge.width - 1; i++) {
-            if(current_char < gauge.label.length()) {
-                short color;
-                if(i - (gauge.x + 1) < bar_width) {
-                    // If label is to be drawn in a bar cell,
-                    // background color of bar should override 
-                    // background color of label
-                    color = get_color(label_color, gauge.bar_color);
-                } else {
-                    color = label_color;
-                }
-                draw_char(
-                    i,
-                    label_y,
-                    gauge.label[current_char],
-                    color
-                );
-            }
-            current_char++;
+        int last_char = std::min((int)gauge.label.length(), std::min(last, gauge.width - 2));
+        for(int current_char = std::max(first, 0); current_char < last_char; current_char++) {
+            // If label is to be drawn in a bar cell,
+            // background color of bar should override
+            // background color of label
+            context.draw_char(
+                gauge.x + 1 + current_char,
+                label_y,
+                gauge.label[current_char],
+                current_char < bar_width ? label_bar_color : label_color
+            );
         }
     }
 
-    // Widget set dimensions shortcut
-    void Widget::set_dimensions(int x_, int y_, int width_, int height_) {
-        x = x_;
-        y = y_;
-        width = width_;
-        height = height_;
+    // Return the number of inner columns the bar of gauge covers
+    inline int gauge_bar_width(const Gauge &gauge) {
+        return floor(((float)gauge.percent / 100) * (gauge.width - 2));
     }
 
-    // Scroll up the list
-    template<>
-    void List::scroll_up(Window &window, int factor) {
-        if(rows.size() > height - 2) {
-            first_element = std::max(0, (int)(first_element - factor));
-            window.add(*this);
+    template<typename Target>
+    void paint(DrawContext<Target> &context, const Gauge &gauge) {
+        if(gauge.border == true) {
+            paint_border(context, gauge);
+        }
+        if(gauge.title.empty() == false) {
+            paint_title(context, gauge);
         }
+        paint_gauge_columns(context, gauge, gauge_bar_width(gauge), 0, gauge.width - 2);
     }
 
-    // Scroll down the list
-    template<>
-    void List::scroll_down(Window &window, int factor) {
-        if(rows.size() > height - 2) {
-            first_element = std::min((int)(rows.size() - (height - 2)), (first_element + factor));
-            window.add(*this);
+    // Draw gauge, or only the columns between the ends of the bar drawn in state and the new bar
+    // The cells of the gauge must still show state
+    template<typename Target>
+    void paint_changes(DrawContext<Target> &context, const Gauge &gauge, PaintState &state) {
+        uint64_t layout = detail::layout_hash(context, gauge);
+        const int64_t values[] = {
+            gauge.bar_color, (int64_t)std::hash<std::string>()(gauge.label),
+            gauge.label_style.foreground, gauge.label_style.background, gauge.label_style.attributes
+        };
+        for(int64_t value : values) {
+            layout = detail::hash_combine(layout, value);
+        }
+        layout |= 1;
+        int bar_width = gauge_bar_width(gauge);
+        if(layout != state.layout || state.values.size() != 1) {
+            paint(context, gauge);
+        } else if(state.values[0] != bar_width) {
+            int inner_width = gauge.width - 2;
+            int old_width = std::max(0, std::min(state.values[0], inner_width));
+            int new_width = std::max(0, std::min(bar_width, inner_width));
+            paint_gauge_columns(context, gauge, bar_width, std::min(old_width, new_width), std::max(old_width, new_width));
+        }
+        state.layout = layout;
+        state.values.assign(1, bar_width);
+    }
+
+    // Only rows in view are formatted, the header row stays at the top
+    template<typename Target>
+    void paint(DrawContext<Target> &context, const Table &table) {
+        if(table.border == true) {
+            paint_border(context, table);
+        }
+        if(table.title.empty() == false) {
+            paint_title(context, table);
+        }
+        // Get colors
+        short text_color = context.style(table.text_style);
+        short header_color = context.style(table.header_style);
+        const TableData &data = *table.data;
+        int inner_width = table.width - 2;
+        int first_column = std::max(table.x + 1, context.left());
+        int last_column = std::min(table.x + table.width - 1, context.right());
+        int last_row = std::min(table.y + table.height - 1, context.bottom());
+        if(inner_width <= 0 || first_column >= last_column) {
+            return;
+        }
+        std::string line;
+        // Lay out row, or the header if row is negative, into line
+        auto format_line = [&](long long row) {
+            line.assign(inner_width, ' ');
+            int position = 0;
+            for(const TableColumn &column : data.columns) {
+                if(position >= inner_width) {
+                    break;
+                }
+                const char *text;
+                int length;
+                char buffer[32];
+                if(row < 0) {
+                    text = column.name.c_str();
+                    length = column.name.length();
+                } else if((size_t)row < column.size()) {
+                    text = column.format(row, buffer, length);
+                } else {
+                    length = 0;
+                    text = "";
+                }
+                length = std::min(length, column.width);
+                // Numbers are aligned to the right
+                int offset = (row >= 0 && column.type != TableColumn::TEXT) ? column.width - length : 0;
+                int count = std::min(length, inner_width - (position + offset));
+                if(count > 0) {
+                    line.replace(position + offset, count, text, count);
+                }
+                position += column.width + 1;
+            }
+        };
+        auto draw_line = [&](int y, short color) {
+            for(int j = first_column; j < last_column; j++) {
+                context.put(j, y, line[j - (table.x + 1)], color);
+            }
+        };
+        int header_row = table.y + 1;
+        if(header_row >= context.top() && header_row < last_row) {
+            format_line(-1);
+            draw_line(header_row, header_color);
+        }
+        size_t visible = table.visible_size();
+        for(int i = std::max(header_row + 1, context.top()); i < last_row; i++) {
+            long long element = (long long)table.first_element + (i - (header_row + 1));
+            if(element >= 0 && (size_t)element < visible) {
+                format_line(table.view ? (*table.view)[element] : element);
+                draw_line(i, text_color);
+            } else {
+                for(int j = first_column; j < last_column; j++) {
+                    context.put(j, i, ' ', 0x000F);
+                }
+            }
         }
     }
+
+    namespace detail {
+        // Reduce a rows x columns matrix to out_rows x out_columns cells, written to out
+        // Matrix rows are pooled into accumulator first, so the inner loops run over
+        // contiguous floats without branches and compilers vectorize them.
+        inline void pool_matrix(const float *values, int rows, int columns, int out_rows, int out_columns,
+                Pooling pooling, std::vector<float> &accumulator, float *out) {
+            accumulator.resize(columns);
+            float *sums = accumulator.data();
+            for(int r = 0; r < out_rows; r++) {
+                int first_row = (int)((int64_t)r * rows / out_rows);
+                int last_row = std::max(first_row + 1, (int)((int64_t)(r + 1) * rows / out_rows));
+                const float *row = values + (size_t)first_row * columns;
+                std::copy(row, row + columns, sums);
+                for(int i = first_row + 1; i < last_row; i++) {
+                    row = values + (size_t)i * columns;
+                    if(pooling == MAX_POOLING) {
+                        for(int j = 0; j < columns; j++) {
+                            sums[j] = sums[j] > row[j] ? sums[j] : row[j];
+                        }
+                    } else {
+                        for(int j = 0; j < columns; j++) {
+                            sums[j] += row[j];
+                        }
+                    }
+                }
+                float *cells = out + (size_t)r * out_columns;
+                for(int c = 0; c < out_columns; c++) {
+                    int first_column = (int)((int64_t)c * columns / out_columns);
+                    int last_column = std::max(first_column + 1, (int)((int64_t)(c + 1) * columns / out_columns));
+                    float value = sums[first_column];
+                    for(int j = first_column + 1; j < last_column; j++) {
+                        value = (pooling == MAX_POOLING) ? (value > sums[j] ? value : sums[j]) : value + sums[j];
+                    }
+                    if(pooling == MEAN_POOLING) {
+                        value /= (float)(last_row - first_row) * (last_column - first_column);
+                    }
+                    cells[c] = value;
+                }
+            }
+        }
+
+        // Map values from minimum to maximum onto levels 0 to count - 1
+        // Values outside the range and NaN are clamped without branches
+        inline void quantize(const float *values, size_t size, float minimum, float maximum, int count, uint8_t *levels) {
+            float scale = maximum > minimum ? count / (maximum - minimum) : 0;
+            float top = (float)(count - 1);
+            for(size_t i = 0; i < size; i++) {
+                float level = (values[i] - minimum) * scale;
+                level = level >= 0 ? level : 0;
+                level = level <= top ? level : top;
+                levels[i] = (uint8_t)level;
+            }
+        }
+    }
+
+    // The matrix is pooled to the cell grid and quantized into reused buffers
+    template<typename Target>
+    void paint(DrawContext<Target> &context, const Heatmap &heatmap) {
+        if(heatmap.border == true) {
+            paint_border(context, heatmap);
+        }
+        if(heatmap.title.empty() == false) {
+            paint_title(context, heatmap);
+        }
+        int inner_width = heatmap.width - 2;
+        int inner_height = heatmap.height - 2;
+        if(heatmap.values == nullptr || heatmap.matrix_rows <= 0 || heatmap.matrix_columns <= 0 || inner_width <= 0 || inner_height <= 0) {
+            return;
+        }
+#ifdef IS_WIN
+        bool half_blocks = heatmap.half_blocks && !heatmap.colors.empty();
+#elif defined(IS_POSIX)
+        // The half block is byte 0xDF of code page 437, which ncurses addch cannot draw
+        bool half_blocks = false;
+#endif
+        int count = std::min<int>(half_blocks ? heatmap.colors.size() : heatmap.ramp.size(), 255);
+        if(count == 0) {
+            return;
+        }
+        int grid_rows = inner_height * (half_blocks ? 2 : 1);
+        size_t cells = (size_t)grid_rows * inner_width;
+        // Buffers only grow, so redrawing does not allocate
+        static thread_local std::vector<float> accumulator;
+        static thread_local std::vector<float> pooled;
+        static thread_local std::vector<uint8_t> levels;
+        if(pooled.size() < cells) {
+            pooled.resize(cells);
+            levels.resize(cells);
+        }
+        detail::pool_matrix(
+            heatmap.values, heatmap.matrix_rows, heatmap.matrix_columns,
+            grid_rows, inner_width, heatmap.pooling, accumulator, pooled.data()
+        );
+        detail::quantize(pooled.data(), cells, heatmap.minimum, heatmap.maximum, count, levels.data());
+        // Get color of each level
+        short level_colors[255];
+        for(int i = 0; i < count; i++) {
+            short foreground = heatmap.colors.empty() ? heatmap.text_style.foreground : heatmap.colors[(size_t)i * heatmap.colors.size() / count];
+            level_colors[i] = context.style({foreground, heatmap.text_style.background, heatmap.text_style.attributes});
+        }
+        int first_column = std::max(heatmap.x + 1, context.left());
+        int last_column = std::min(heatmap.x + heatmap.width - 1, context.right());
+        int last_row = std::min(heatmap.y + heatmap.height - 1, context.bottom());
+        for(int i = std::max(heatmap.y + 1, context.top()); i < last_row; i++) {
+            int row = i - (heatmap.y + 1);
+            for(int j = first_column; j < last_column; j++) {
+                int column = j - (heatmap.x + 1);
+                if(half_blocks) {
+                    // Upper half block in the color of the top row over the color of the bottom row
+                    uint8_t top = levels[(size_t)(2 * row) * inner_width + column];
+                    uint8_t bottom = levels[(size_t)(2 * row + 1) * inner_width + column];
+                    context.put(j, i, (char)0xDF, context.style({heatmap.colors[top], heatmap.colors[bottom]}));
+                } else {
+                    uint8_t level = levels[(size_t)row * inner_width + column];
+                    context.put(j, i, heatmap.ramp[level], level_colors[level]);
+                }
+            }
+        }
+    }
+
+    // The start of the first line in view is found from the nearest checkpoint,
+    // the following lines are found with memchr while drawing
+    template<typename Target>
+    void paint(DrawContext<Target> &context, const FileView &file_view) {
+        if(file_view.border == true) {
+            paint_border(context, file_view);
+        }
+        if(file_view.title.empty() == false) {
+            paint_title(context, file_view);
+        }
+        if(!file_view.file) {
+            return;
+        }
+        short text_color = context.style(file_view.text_style);
+        std::shared_ptr<const detail::FileMapping> mapping;
+        uint64_t start;
+        uint64_t lines = file_view.size();
+        {
+            std::lock_guard<std::mutex> lock(file_view.file->mutex);
+            mapping = file_view.file->mapping;
+            uint64_t checkpoint = std::min<uint64_t>(file_view.first_line / detail::FileIndex::stride, file_view.file->checkpoints.size() - 1);
+            start = file_view.file->checkpoints[checkpoint];
+            // Skip to the first line
+            for(uint64_t line = checkpoint * detail::FileIndex::stride; line < file_view.first_line && line < lines; line++) {
+                const void *end = memchr(mapping->data + start, '\n', mapping->size - start);
+                start = (end != nullptr) ? (const char *)end - mapping->data + 1 : mapping->size;
+            }
+        }
+        int first_column = std::max(file_view.x + 1, context.left());
+        int last_column = std::min(file_view.x + file_view.width - 1, context.right());
+        int last_row = std::min(file_view.y + file_view.height - 1, context.bottom());
+        int tab_width = std::max(file_view.tab_width, 1);
+        for(int i = file_view.y + 1; i < last_row; i++) {
+            uint64_t line = file_view.first_line + (i - (file_view.y + 1));
+            const char *text = nullptr;
+            uint64_t length = 0;
+            if(line < lines && start <= mapping->size) {
+                text = mapping->data + start;
+                const void *end = memchr(text, '\n', mapping->size - start);
+                length = (end != nullptr) ? (const char *)end - text : mapping->size - start;
+                start += length + 1;
+            }
+            if(i < context.top()) {
+                continue;
+            }
+            // Expand tabs and hide control characters, starting at first_column of the line
+            int column = -file_view.first_column;
+            uint64_t k = 0;
+            for(int j = first_column; j < last_column; j++) {
+                while(column < j - (file_view.x + 1) && k < length) {
+                    column += (text[k++] == '\t') ? tab_width - (column + file_view.first_column) % tab_width : 1;
+                }
+                char c = ' ';
+                if(column == j - (file_view.x + 1) && k < length && text[k] != '\t' && text[k] != '\r') {
+                    c = (unsigned char)text[k] < ' ' ? ' ' : text[k];
+                }
+                context.put(j, i, c, text_color);
+            }
+        }
+    }
+
+    // Tabs are " title " separated by "|" on the first inner row
+    template<typename Target>
+    void paint(DrawContext<Target> &context, const Tabs &tabs) {
+        if(tabs.border == true) {
+            paint_border(context, tabs);
+        }
+        if(tabs.title.empty() == false) {
+            paint_title(context, tabs);
+        }
+        int inset = tabs.border ? 1 : 0;
+        int row = tabs.y + inset;
+        if(tabs.height <= 2 * inset || row < context.top() || row >= context.bottom()) {
+            return;
+        }
+        short text_color = context.style(tabs.text_style);
+        short active_color = context.style(tabs.active_style);
+        short separator_color = context.style(tabs.border_style);
+        int first_column = std::max(tabs.x + inset, context.left());
+        int last_column = std::min(tabs.x + tabs.width - inset, context.right());
+        int x = tabs.x + inset;
+        for(size_t i = 0; i < tabs.titles.size() && x < last_column; i++) {
+            short color = (int)i == tabs.active ? active_color : text_color;
+            const std::string &title = tabs.titles[i];
+            for(int j = -1; j <= (int)title.length() && x < last_column; j++, x++) {
+                if(x >= first_column) {
+                    context.put(x, row, j >= 0 && j < (int)title.length() ? title[j] : ' ', color);
+                }
+            }
+            if(x >= first_column && x < last_column) {
+                context.put(x, row, '|', separator_color);
+            }
+            x++;
+        }
+        for(x = std::max(x, first_column); x < last_column; x++) {
+            context.put(x, row, ' ', 0x000F);
+        }
+    }
+
+    // Single character cell of a frame
+    // Four bytes, so rows of frames and surfaces stay small and cheap to compare
+    struct Cell {
+        char glyph = ' ';
+        short color = 0; // Style id in the StyleTable of the frame
+    };
+
+    static_assert(sizeof(Cell) <= 4, "Cell should stay packed");
+
+    inline bool operator==(const Cell &cell1, const Cell &cell2) {
+        return cell1.glyph == cell2.glyph && cell1.color == cell2.color;
+    }
+
+    inline bool operator!=(const Cell &cell1, const Cell &cell2) {
+        return !(cell1 == cell2);
+    }
+
+    // Off-screen cell buffer which widgets can be drawn into
+    // The surface covers bounds(), so widgets are drawn at their usual position
+    // relative to the origin and the surface can be blitted into a window or
+    // another surface as often as needed.
+    class Surface {
+        public:
+            uint64_t fingerprint = 0; // Fingerprint of cached widget, see Window::add_cached
+            StyleTable styles;        // Styles of the cells
+
+            Surface(int columns = 0, int rows = 0) {
+                reset({0, 0, columns, rows});
+            }
+
+            // Cover rect and clear every cell
+            void reset(const Rect &rect) {
+                origin_x = rect.x;
+                origin_y = rect.y;
+                columns_ = std::max(0, rect.width);
+                rows_ = std::max(0, rect.height);
+                cells.assign((size_t)columns_ * rows_, Cell{});
+                fingerprint = 0;
+            }
+
+            // Move the area covered by the surface without changing its cells
+            inline void set_origin(int x, int y) {
+                origin_x = x;
+                origin_y = y;
+            }
+
+            // Set every cell to cell
+            inline void clear(const Cell &cell = Cell{}) {
+                std::fill(cells.begin(), cells.end(), cell);
+            }
+
+            inline int columns() const {
+                return columns_;
+            }
+
+            inline int rows() const {
+                return rows_;
+            }
+
+            // Return the area covered by the surface
+            inline Rect bounds() const {
+                return {origin_x, origin_y, columns_, rows_};
+            }
+
+            // Return cells of row y relative to the surface
+            inline const Cell *row(int y) const {
+                return cells.data() + (size_t)y * columns_;
+            }
+
+            // Return cell at x and y relative to the origin
+            inline const Cell &at(int x, int y) const {
+                return cells[(size_t)(y - origin_y) * columns_ + (x - origin_x)];
+            }
+
+            // Set character of a cell known to be inside bounds()
+            inline void put(int x, int y, char c, short color) {
+                Cell &cell = cells[(size_t)(y - origin_y) * columns_ + (x - origin_x)];
+                cell.glyph = c;
+                cell.color = color;
+            }
+
+            // Set color of a cell known to be inside bounds()
+            inline void put_color(int x, int y, short color) {
+                cells[(size_t)(y - origin_y) * columns_ + (x - origin_x)].color = color;
+            }
+
+            // Write count characters in one style to a row known to be inside bounds()
+            inline void put_text(int x, int y, const char *text, int count, short color) {
+                Cell *row = &cells[(size_t)(y - origin_y) * columns_ + (x - origin_x)];
+                for(int i = 0; i < count; i++) {
+                    row[i] = {text[i], color};
+                }
+            }
+
+            // Set character in surface
+            void draw_char(int x, int y, char c, short color = 0x000F) {
+                DrawContext<Surface>(*this, bounds()).draw_char(x, y, c, color);
+            }
+
+            // Draw one or more widgets into the surface
+            template<typename Widget, typename ... Rest>
+            void add(const Widget &first, const Rest &... rest) {
+                DrawContext<Surface> context(*this, bounds().intersect(first.rect()), &styles);
+                paint(context, first);
+                (add(rest), ...);
+            }
+
+            // Draw every widget of a static scene
+            template<typename ... Widgets>
+            void add(const StaticScene<Widgets...> &scene) {
+                std::apply([this](const Widgets &... widgets) {
+                    add(widgets...);
+                }, scene.widgets);
+            }
+
+            // Copy source into this surface at the origin of source
+            void blit(const Surface &source) {
+                Rect area = bounds().intersect(source.bounds());
+                bool restyle = source.styles.size() > StyleTable::plain_styles;
+                for(int y = area.y; y < area.y + area.height; y++) {
+                    const Cell *from = &source.at(area.x, y);
+                    Cell *to = &cells[(size_t)(y - origin_y) * columns_ + (area.x - origin_x)];
+                    std::copy(from, from + area.width, to);
+                    // Styles of source may have other ids here
+                    for(int x = 0; restyle && x < area.width; x++) {
+                        to[x].color = styles.import(source.styles, to[x].color);
+                    }
+                }
+            }
+
+        private:
+            std::vector<Cell> cells;
+            int origin_x = 0;
+            int origin_y = 0;
+            int columns_ = 0;
+            int rows_ = 0;
+    };
+
+    // Panes of widgets of which only the active one is shown, e.g. the tabs of a console
+    // Tabs are drawn on the top row and panes below them. Hidden panes are not drawn and
+    // their refresh callbacks do not run. Each pane is drawn into its own surface, which
+    // is blitted as is while none of its widgets changed, so switching back to a pane
+    // draws no widgets. Like Window::add_cached this relies on widgets being changed
+    // through setters or touch(). Panes keep pointers to their widgets.
+    class PaneStack {
+        public:
+            typedef std::chrono::steady_clock Clock;
+
+            Tabs tabs;
+            uint64_t id = detail::next_widget_id(); // Identity for the widget cache and mouse events
+
+            PaneStack() {
+                set_dimensions(0, 0, 0, 0);
+            }
+
+            // Cover a rectangle, the tabs take its top row
+            void set_dimensions(int x, int y, int width, int height) {
+                area = {x, y, width, height};
+                tabs.border = false;
+                tabs.set_dimensions(x, y, width, std::min(height, 1));
+            }
+
+            inline Rect rect() const {
+                return area;
+            }
+
+            // Return the area panes are drawn in
+            inline Rect pane_rect() const {
+                return {area.x, area.y + 1, area.width, std::max(0, area.height - 1)};
+            }
+
+            // Add a pane showing widgets under title and return its index
+            // Widgets must outlive the pane stack
+            template<typename ... Widgets>
+            size_t add_pane(const std::string &title, Widgets &... widgets) {
+                Pane pane;
+                pane.widgets = {&widgets...};
+                pane.draw = [&widgets...](Surface &surface) {
+                    if constexpr(sizeof...(Widgets) > 0) {
+                        surface.add(widgets...);
+                    }
+                };
+                pane.fingerprint = [&widgets...]() {
+                    uint64_t hash = 1;
+                    ((hash = detail::hash_combine(hash, widgets.fingerprint())), ...);
+                    return hash;
+                };
+                panes.push_back(std::move(pane));
+                tabs.titles.push_back(title);
+                tabs.touch();
+                return panes.size() - 1;
+            }
+
+            // Call refresh every interval milliseconds while pane is active,
+            // e.g. to update the data of its widgets
+            void set_refresh(size_t pane, int interval, std::function<void()> refresh) {
+                panes.at(pane).refresh = std::move(refresh);
+                panes.at(pane).interval = std::max(0, interval);
+                panes.at(pane).due = Clock::time_point();
+            }
+
+            // Show pane, throws TUIException if there is no such pane
+            void select(size_t pane) {
+                if(pane >= panes.size()) {
+                    throw TUIException("Pane does not exist");
+                }
+                active_ = pane;
+                tabs.active = (int)pane;
+                tabs.touch();
+            }
+
+            inline size_t active() const {
+                return active_;
+            }
+
+            inline size_t size() const {
+                return panes.size();
+            }
+
+            // Run the refresh of the active pane if it is due and return true if it ran
+            bool refresh(Clock::time_point now = Clock::now()) {
+                if(panes.empty() || !panes[active_].refresh || now < panes[active_].due) {
+                    return false;
+                }
+                Pane &pane = panes[active_];
+                pane.due = now + std::chrono::milliseconds(pane.interval);
+                pane.refresh();
+                return true;
+            }
+
+            // Return milliseconds until the refresh of the active pane is due, -1 without one
+            int next_timeout(Clock::time_point now = Clock::now()) const {
+                if(panes.empty() || !panes[active_].refresh) {
+                    return -1;
+                }
+                auto remaining = std::chrono::ceil<std::chrono::milliseconds>(panes[active_].due - now).count();
+                return (int)std::max<int64_t>(0, remaining);
+            }
+
+            // Return the surface of the active pane, drawn again only if its widgets changed
+            const Surface &surface() {
+                if(panes.empty()) {
+                    empty.reset(pane_rect());
+                    return empty;
+                }
+                Pane &pane = panes[active_];
+                Rect bounds = pane.cache.bounds();
+                Rect expected = pane_rect();
+                uint64_t fingerprint = pane.fingerprint();
+                if(
+                    bounds.x != expected.x || bounds.y != expected.y ||
+                    bounds.width != expected.width || bounds.height != expected.height ||
+                    pane.cache.fingerprint != fingerprint) {
+                    pane.cache.reset(expected);
+                    pane.draw(pane.cache);
+                    pane.cache.fingerprint = fingerprint;
+                }
+                return pane.cache;
+            }
+
+            // Return the widgets of the active pane
+            inline const std::vector<const Widget *> &widgets() const {
+                static const std::vector<const Widget *> none;
+                return panes.empty() ? none : panes[active_].widgets;
+            }
+
+            // Hash of the active pane, its widgets, the tabs and the area
+            uint64_t fingerprint() const {
+                uint64_t hash = tabs.fingerprint();
+                const int64_t values[] = {(int64_t)active_, area.x, area.y, area.width, area.height};
+                for(int64_t value : values) {
+                    hash = detail::hash_combine(hash, value);
+                }
+                return panes.empty() ? hash : detail::hash_combine(hash, panes[active_].fingerprint());
+            }
+
+            // Show the pane whose tab was clicked and return true if one was
+            template<typename Window>
+            bool handle_event(Window &window, const Event &event) {
+                if(
+                    event.type != MOUSEBUTTONDOWN || event.button != BUTTON_LEFT ||
+                    !tabs.rect().contains(event.x, event.y) || window.widget_at(event.x, event.y) != tabs.id) {
+                    return false;
+                }
+                int pane = tabs.tab_at(event.x);
+                if(pane < 0 || pane >= (int)panes.size()) {
+                    return false;
+                }
+                select(pane);
+                return true;
+            }
+
+        private:
+            struct Pane {
+                std::vector<const Widget *> widgets;
+                std::function<void(Surface &)> draw;
+                std::function<uint64_t()> fingerprint;
+                std::function<void()> refresh;
+                int interval = 0;
+                Clock::time_point due; // Next refresh while active
+                Surface cache;         // Last drawn content
+            };
+
+            std::vector<Pane> panes;
+            size_t active_ = 0;
+            Rect area;
+            Surface empty;
+    };
+
+    namespace detail {
+        // Threads running batches of independent jobs, the calling thread helps
+        // Jobs are split into one range per thread, threads which finish their own
+        // range steal the remaining jobs of the other ranges.
+        class WorkStealingPool {
+            public:
+                // Run jobs on threads threads including the caller
+                WorkStealingPool(unsigned threads) : ranges(new Range[std::max(threads, 1u)]), range_count(std::max(threads, 1u)) {
+                    for(unsigned i = 1; i < range_count; i++) {
+                        workers.emplace_back([this, i]() {
+                            loop(i);
+                        });
+                    }
+                }
+
+                ~WorkStealingPool() {
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        stopping = true;
+                    }
+                    wake.notify_all();
+                    for(std::thread &worker : workers) {
+                        worker.join();
+                    }
+                }
+
+                WorkStealingPool(const WorkStealingPool &) = delete;
+                WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+                // Call job(i) for every i below count, return when every call finished
+                // The first exception thrown by a job is rethrown
+                void run(size_t count, const std::function<void(size_t)> &job) {
+                    if(count == 0) {
+                        return;
+                    }
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        for(unsigned i = 0; i < range_count; i++) {
+                            ranges[i].next = count * i / range_count;
+                            ranges[i].end = count * (i + 1) / range_count;
+                        }
+                        current = &job;
+                        error = nullptr;
+                        active = range_count - 1;
+                        batch++;
+                    }
+                    wake.notify_all();
+                    work(0);
+                    std::unique_lock<std::mutex> lock(mutex);
+                    finished.wait(lock, [this]() {
+                        return active == 0;
+                    });
+                    current = nullptr;
+                    if(error) {
+                        std::rethrow_exception(error);
+                    }
+                }
+
+                // Return the number of threads running jobs, including the caller
+                inline unsigned size() const {
+                    return range_count;
+                }
+
+            private:
+                struct alignas(64) Range {
+                    std::atomic<size_t> next{0}; // Next job of the range to run
+                    size_t end = 0;
+                };
+
+                std::unique_ptr<Range[]> ranges;
+                unsigned range_count;
+                std::vector<std::thread> workers;
+                std::mutex mutex;
+                std::condition_variable wake;     // A batch started or the pool stops
+                std::condition_variable finished; // Every worker finished the batch
+                const std::function<void(size_t)> *current = nullptr;
+                std::exception_ptr error;
+                uint64_t batch = 0;
+                unsigned active = 0; // Workers still running the batch
+                bool stopping = false;
+
+                void loop(unsigned self) {
+                    uint64_t done = 0;
+                    while(true) {
+                        {
+                            std::unique_lock<std::mutex> lock(mutex);
+                            wake.wait(lock, [&]() {
+                                return stopping || batch != done;
+                            });
+                            if(stopping) {
+                                return;
+                            }
+                            done = batch;
+                        }
+                        work(self);
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if(--active == 0) {
+                            finished.notify_one();
+                        }
+                    }
+                }
+
+                // Run the jobs of the own range, then steal from the others
+                void work(unsigned self) {
+                    for(unsigned i = 0; i < range_count; i++) {
+                        Range &range = ranges[(self + i) % range_count];
+                        size_t job;
+                        while((job = range.next.fetch_add(1)) < range.end) {
+                            try {
+                                (*current)(job);
+                            } catch(...) {
+                                std::lock_guard<std::mutex> lock(mutex);
+                                if(!error) {
+                                    error = std::current_exception();
+                                }
+                            }
+                        }
+                    }
+                }
+        };
+
+        // True if Target can copy a run of cells to a row with blit_row()
+        template<typename Target, typename = void>
+        struct has_blit_row : std::false_type {};
+
+        template<typename Target>
+        struct has_blit_row<Target, std::void_t<decltype(std::declval<Target &>().blit_row(0, 0, (const Cell *)nullptr, 0))> > : std::true_type {};
+
+        // Cells drawn by one widget of a parallel batch, with the styles it used
+        struct RasterLayer {
+            Rect area; // Cells the widget may draw
+            std::vector<Cell> cells;
+            std::vector<uint8_t> drawn; // UNDRAWN, DRAWN or only COLORED
+            StyleTable styles;
+            std::vector<short> ids; // Ids of styles in the target, from plain_styles on
+            std::vector<Cell> run;  // Drawn cells of a row with target style ids
+            std::function<void(RasterLayer &)> paint;
+
+            enum { UNDRAWN, DRAWN, COLORED };
+
+            void reset(const Rect &area_) {
+                area = area_;
+                size_t size = area.empty() ? 0 : (size_t)area.width * area.height;
+                cells.resize(size);
+                drawn.assign(size, UNDRAWN);
+                styles = StyleTable();
+            }
+
+            inline void put(int x, int y, char c, short color) {
+                size_t i = (size_t)(y - area.y) * area.width + (x - area.x);
+                cells[i] = {c, color};
+                drawn[i] = DRAWN;
+            }
+
+            inline void put_color(int x, int y, short color) {
+                size_t i = (size_t)(y - area.y) * area.width + (x - area.x);
+                cells[i].color = color;
+                if(drawn[i] == UNDRAWN) {
+                    drawn[i] = COLORED;
+                }
+            }
+
+            // Draw the cells into target, whose styles are in table
+            // Styles are added to table in the order the widget used them, like drawing it into target would
+            // Runs of drawn cells are copied with one blit_row() call if the target has it
+            template<typename Target>
+            void copy_to(Target &target, StyleTable *table) {
+                ids.resize(styles.size() - StyleTable::plain_styles);
+                for(int id = StyleTable::plain_styles; id < styles.size(); id++) {
+                    Style style = styles.get((short)id);
+                    ids[id - StyleTable::plain_styles] = table != nullptr ? table->intern(style) : get_color(style.foreground & 0xF, style.background & 0xF);
+                }
+                auto target_color = [this](short color) {
+                    if(color >= StyleTable::plain_styles && color < styles.size()) {
+                        return ids[color - StyleTable::plain_styles];
+                    }
+                    return color;
+                };
+                for(int y = 0; y < (area.empty() ? 0 : area.height); y++) {
+                    const Cell *row = &cells[(size_t)y * area.width];
+                    const uint8_t *row_drawn = &drawn[(size_t)y * area.width];
+                    int x = 0;
+                    while(x < area.width) {
+                        if(row_drawn[x] == COLORED) {
+                            target.put_color(area.x + x, area.y + y, target_color(row[x].color));
+                            x++;
+                            continue;
+                        }
+                        int end = x;
+                        while(end < area.width && row_drawn[end] == row_drawn[x]) {
+                            end++;
+                        }
+                        if(row_drawn[x] == DRAWN) {
+                            if constexpr(has_blit_row<Target>::value) {
+                                run.resize(end - x);
+                                for(int i = x; i < end; i++) {
+                                    run[i - x] = {row[i].glyph, target_color(row[i].color)};
+                                }
+                                target.blit_row(area.x + x, area.y + y, run.data(), end - x);
+                            } else {
+                                for(int i = x; i < end; i++) {
+                                    target.put(area.x + i, area.y + y, row[i].glyph, target_color(row[i].color));
+                                }
+                            }
+                        }
+                        x = end;
+                    }
+                }
+            }
+        };
+
+        template<typename Widget, typename = void>
+        struct is_paintable : std::false_type {};
+
+        template<typename Widget>
+        struct is_paintable<Widget, decltype(paint(std::declval<DrawContext<RasterLayer> &>(), std::declval<const Widget &>()))> : std::true_type {};
+
+        // Widgets painted into separate layers on a pool, then drawn into a target in order
+        // The result is the same as painting them into the target one after the other.
+        class RasterBatch {
+            public:
+                // Queue widget to be painted within clip, widget must live until run()
+                template<typename Widget>
+                void queue(const Widget &widget, const Rect &clip) {
+                    if(count == layers.size()) {
+                        layers.emplace_back(new RasterLayer());
+                    }
+                    RasterLayer &layer = *layers[count++];
+                    layer.reset(clip.intersect(widget.rect()));
+                    layer.paint = [&widget](RasterLayer &target) {
+                        DrawContext<RasterLayer> context(target, target.area, &target.styles);
+                        paint(context, widget);
+                    };
+                }
+
+                // Paint the queued widgets on pool, then draw them into target whose styles are in table
+                template<typename Target>
+                void run(WorkStealingPool &pool, Target &target, StyleTable *table) {
+                    size_t queued = count;
+                    count = 0;
+                    pool.run(queued, [this](size_t i) {
+                        layers[i]->paint(*layers[i]);
+                    });
+                    for(size_t i = 0; i < queued; i++) {
+                        layers[i]->copy_to(target, table);
+                    }
+                }
+
+            private:
+                std::vector<std::unique_ptr<RasterLayer> > layers; // Reused by later batches
+                size_t count = 0; // Queued layers
+        };
+    }
+
+    // Receives a copy of every rendered frame
+    class FrameSink {
+        public:
+            virtual ~FrameSink() {}
+            // Cell colors are ids of styles, which may be null if every style is plain
+            virtual void submit(const Cell *cells, int columns, int rows, const StyleTable *styles = nullptr) = 0;
+    };
+
+    // Hierarchical timer wheel with millisecond ticks
+    // Four levels of 64 slots cover about 4.6 hours, later timers wait in the last level.
+    // Scheduling and cancelling are O(1), timers move to lower levels as their slot comes up.
+    class TimerWheel {
+        public:
+            typedef uint64_t TimerId;
+            typedef std::chrono::steady_clock Clock;
+
+            TimerWheel(Clock::time_point start = Clock::now()) : start(start) {
+                for(int level = 0; level < levels; level++) {
+                    occupied[level] = 0;
+                    for(int slot = 0; slot < slots; slot++) {
+                        heads[level][slot] = none;
+                    }
+                }
+            }
+
+            // Call callback after delay milliseconds, then every interval milliseconds if interval > 0
+            // Returns an id for cancel, ids are never 0
+            TimerId schedule(int delay, std::function<void()> callback, int interval = 0) {
+                uint32_t index;
+                if(free_nodes.empty()) {
+                    index = (uint32_t)nodes.size();
+                    nodes.emplace_back();
+                } else {
+                    index = free_nodes.back();
+                    free_nodes.pop_back();
+                }
+                Node &node = nodes[index];
+                // Timers due now fire on the next tick
+                node.deadline = current + (uint64_t)std::max(delay, 1);
+                node.interval = std::max(interval, 0);
+                node.callback = std::move(callback);
+                node.active = true;
+                place(index);
+                count++;
+                return ((TimerId)node.generation << 32) | (index + 1);
+            }
+
+            // Stop a timer, returns false if it already fired or was cancelled
+            bool cancel(TimerId id) {
+                uint32_t index = (uint32_t)(id & 0xFFFFFFFF) - 1;
+                if(index >= nodes.size() || !nodes[index].active || nodes[index].generation != (uint32_t)(id >> 32)) {
+                    return false;
+                }
+                unlink(index);
+                release(index);
+                return true;
+            }
+
+            // Fire every timer due at now, returns the number of callbacks run
+            // Callbacks may schedule and cancel timers, including their own
+            size_t advance(Clock::time_point now) {
+                uint64_t target = tick_of(now);
+                size_t fired = 0;
+                while(current < target) {
+                    if(count == 0) {
+                        // Nothing to fire on the way, jump straight to now
+                        current = target;
+                        break;
+                    }
+                    if(occupied[0] == 0) {
+                        // Level 0 is empty, skip ahead to the next cascade
+                        current = std::min(target - 1, current | mask);
+                    }
+                    current++;
+                    cascade();
+                    fired += expire((int)(current & mask));
+                }
+                return fired;
+            }
+
+            // Return milliseconds until the next timer is due from now, 0 if one is due, -1 without timers
+            int next_timeout(Clock::time_point now) const {
+                if(count == 0) {
+                    return -1;
+                }
+                uint64_t next = UINT64_MAX;
+                for(int level = 0; level < levels; level++) {
+                    // The current slot only holds timers a full turn away so it comes last
+                    int first = (int)(((current >> (level * bits)) + 1) & mask);
+                    uint64_t rotated = rotate(occupied[level], first);
+                    if(rotated == 0) {
+                        continue;
+                    }
+                    int slot = (first + lowest_bit(rotated)) & mask;
+                    for(uint32_t index = heads[level][slot]; index != none; index = nodes[index].next) {
+                        next = std::min(next, nodes[index].deadline);
+                    }
+                }
+                uint64_t elapsed = tick_of(now);
+                if(next <= elapsed) {
+                    return 0;
+                }
+                return (int)std::min<uint64_t>(next - elapsed, INT_MAX);
+            }
+
+            // Return the number of scheduled timers
+            inline size_t size() const {
+                return count;
+            }
+
+        private:
+            static const int bits = 6;
+            static const int slots = 1 << bits;
+            static const uint64_t mask = slots - 1;
+            static const int levels = 4;
+            static const uint32_t none = UINT32_MAX;
+
+            struct Node {
+                uint64_t deadline = 0; // Tick the timer is due
+                int interval = 0;      // Repeat period, 0 for one shot timers
+                uint32_t generation = 1;
+                uint32_t prev = none;
+                uint32_t next = none;
+                int level = -1;        // -1 while not linked in a slot
+                int slot = 0;
+                bool active = false;
+                std::function<void()> callback;
+            };
+
+            Clock::time_point start;
+            uint64_t current = 0;           // Last processed tick
+            std::deque<Node> nodes;         // Deque keeps callbacks in place while new timers are added
+            std::vector<uint32_t> free_nodes;
+            uint32_t heads[levels][slots];  // First node of each slot
+            uint64_t occupied[levels];      // Bit set for every non empty slot
+            size_t count = 0;
+            std::vector<std::pair<uint32_t, uint32_t> > due; // Nodes and generations of the slot being expired
+
+            uint64_t tick_of(Clock::time_point now) const {
+                if(now <= start) {
+                    return 0;
+                }
+                return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count();
+            }
+
+            static inline uint64_t rotate(uint64_t value, int amount) {
+                return amount == 0 ? value : (value >> amount) | (value << (slots - amount));
+            }
+
+            static inline int lowest_bit(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+                return __builtin_ctzll(value);
+#else
+                int bit = 0;
+                while(!(value & 1)) {
+                    value >>= 1;
+                    bit++;
+                }
+                return bit;
+#endif
+            }
+
+            // Link node into the slot of the lowest level that covers its deadline
+            // Cascaded timers due at the current tick go to its level 0 slot, which expires next
+            void place(uint32_t index) {
+                Node &node = nodes[index];
+                uint64_t deadline = std::max(node.deadline, current);
+                uint64_t delta = deadline - current;
+                int level = 0;
+                while(level < levels - 1 && delta >= ((uint64_t)1 << (bits * (level + 1)))) {
+                    level++;
+                }
+                if(level == levels - 1) {
+                    // Clamp far timers to the span of the wheel, they are placed again on cascade
+                    uint64_t span = ((uint64_t)1 << (bits * levels)) - 1;
+                    deadline = current + std::min(delta, span);
+                }
+                int slot = (int)((deadline >> (bits * level)) & mask);
+                node.level = level;
+                node.slot = slot;
+                node.prev = none;
+                node.next = heads[level][slot];
+                if(node.next != none) {
+                    nodes[node.next].prev = index;
+                }
+                heads[level][slot] = index;
+                occupied[level] |= (uint64_t)1 << slot;
+            }
+
+            void unlink(uint32_t index) {
+                Node &node = nodes[index];
+                if(node.level < 0) {
+                    return;
+                }
+                if(node.prev != none) {
+                    nodes[node.prev].next = node.next;
+                } else {
+                    heads[node.level][node.slot] = node.next;
+                    if(node.next == none) {
+                        occupied[node.level] &= ~((uint64_t)1 << node.slot);
+                    }
+                }
+                if(node.next != none) {
+                    nodes[node.next].prev = node.prev;
+                }
+                node.prev = node.next = none;
+                node.level = -1;
+            }
+
+            void release(uint32_t index) {
+                Node &node = nodes[index];
+                node.active = false;
+                node.callback = nullptr;
+                node.generation++;
+                free_nodes.push_back(index);
+                count--;
+            }
+
+            // Move timers of higher level slots which start at the current tick down the wheel
+            // Higher levels go first so their timers can land in lower slots still to be cascaded
+            void cascade() {
+                int top = 0;
+                while(top < levels - 1 && (current & (((uint64_t)1 << (bits * (top + 1))) - 1)) == 0) {
+                    top++;
+                }
+                for(int level = top; level > 0; level--) {
+                    int slot = (int)((current >> (bits * level)) & mask);
+                    uint32_t index = heads[level][slot];
+                    heads[level][slot] = none;
+                    occupied[level] &= ~((uint64_t)1 << slot);
+                    while(index != none) {
+                        uint32_t next = nodes[index].next;
+                        place(index);
+                        index = next;
+                    }
+                }
+            }
+
+            // Fire the timers of a level 0 slot
+            size_t expire(int slot) {
+                due.clear();
+                uint32_t index = heads[0][slot];
+                while(index != none) {
+                    Node &node = nodes[index];
+                    due.push_back(std::make_pair(index, node.generation));
+                    index = node.next;
+                    node.level = -1;
+                    node.prev = node.next = none;
+                }
+                heads[0][slot] = none;
+                occupied[0] &= ~((uint64_t)1 << slot);
+                size_t fired = 0;
+                for(size_t i = 0; i < due.size(); i++) {
+                    Node &node = nodes[due[i].first];
+                    if(!node.active || node.generation != due[i].second) {
+                        // Cancelled by an earlier callback
+                        continue;
+                    }
+                    fired++;
+                    std::function<void()> callback = std::move(node.callback);
+                    if(node.interval > 0) {
+                        // Keep the phase, skipping periods missed while the loop was busy
+                        node.deadline += node.interval * ((current - node.deadline) / node.interval + 1);
+                        place(due[i].first);
+                        callback();
+                        Node &after = nodes[due[i].first];
+                        if(after.active && after.generation == due[i].second) {
+                            after.callback = std::move(callback);
+                        }
+                    } else {
+                        release(due[i].first);
+                        callback();
+                    }
+                }
+                return fired;
+            }
+    };
+
+    // Phases of the latency of an event
+    enum LatencyPhase {
+        PHASE_QUEUE,       // Input read until the event was returned to the application
+        PHASE_APPLICATION, // Handling the event, without drawing
+        PHASE_RASTER,      // Drawing widgets into the window
+        PHASE_OUTPUT,      // Writing the frame to the terminal
+        PHASE_TOTAL        // Input read until the frame showing its handling was written
+    };
+
+    // Input to display latency of events in microseconds, by event type and phase
+    // Every phase is counted in a Histogram with HDR bins, which can also be drawn.
+    class LatencyStats {
+        public:
+            static const int phases = PHASE_TOTAL + 1;
+
+            LatencyStats() : histograms((UNDEFINED + 1) * phases) {}
+
+            // Count the phase durations of an event of type
+            void record(EventType type, const double (&durations)[phases]) {
+                Histogram *phase = &histograms[type * phases];
+                if(phase[PHASE_TOTAL].counts.empty()) {
+                    // 1 microsecond to 10 seconds within 1/8
+                    for(int i = 0; i < phases; i++) {
+                        phase[i].set_hdr_bins(1, 1e7, 3);
+                    }
+                }
+                for(int i = 0; i < phases; i++) {
+                    phase[i].push(durations[i]);
+                }
+            }
+
+            // Return the histogram of phase of events of type
+            inline const Histogram &histogram(EventType type, LatencyPhase phase = PHASE_TOTAL) const {
+                return histograms[type * phases + phase];
+            }
+
+            // Return the number of events of type
+            inline size_t count(EventType type) const {
+                return (size_t)histogram(type).total;
+            }
+
+            // Return the estimated percentile of phase of events of type in microseconds
+            inline double percentile(EventType type, double percent, LatencyPhase phase = PHASE_TOTAL) const {
+                return histogram(type, phase).percentile(percent);
+            }
+
+            // Return one line of percentiles in milliseconds for every event type with events
+            std::string report() const {
+                static const char *names[UNDEFINED + 1] = {
+                    "KEYDOWN", "MOUSEBUTTONDOWN", "MOUSEBUTTONUP", "MOUSEMOTION", "MOUSEWHEEL",
+                    "FOCUSIN", "FOCUSOUT", "PASTE", "WINDOWRESIZE", "UNDEFINED"
+                };
+                std::string result;
+                char line[256];
+                for(int type = 0; type <= UNDEFINED; type++) {
+                    EventType event_type = (EventType)type;
+                    if(count(event_type) == 0) {
+                        continue;
+                    }
+                    auto ms = [&](double percent, LatencyPhase phase) {
+                        return percentile(event_type, percent, phase) / 1000;
+                    };
+                    snprintf(
+                        line, sizeof(line),
+                        "%s: %zu events, p50 %.2f p95 %.2f p99 %.2f ms "
+                        "(p95 queue %.2f application %.2f raster %.2f output %.2f ms)\n",
+                        names[type], count(event_type),
+                        ms(50, PHASE_TOTAL), ms(95, PHASE_TOTAL), ms(99, PHASE_TOTAL),
+                        ms(95, PHASE_QUEUE), ms(95, PHASE_APPLICATION), ms(95, PHASE_RASTER), ms(95, PHASE_OUTPUT)
+                    );
+                    result += line;
+                }
+                return result;
+            }
+
+            void clear() {
+                for(Histogram &histogram : histograms) {
+                    if(!histogram.counts.empty()) {
+                        histogram.clear();
+                    }
+                }
+            }
+
+        private:
+            std::vector<Histogram> histograms; // Phases of every event type, binned on first use
+    };
+
+    // Paces frames written to a terminal which may read them slower than they are rendered
+    // The terminal lags when more than backlog bytes of earlier frames are not written or
+    // not read yet, or when writing a frame took stall milliseconds. Frames are held back meanwhile and the interval between frames doubles,
+    // every frame written while the terminal keeps up shortens it by a quarter.
+    class OutputPacer {
+        public:
+            typedef std::chrono::steady_clock Clock;
+            static const int stall = 10;
+
+            OutputPacer(size_t backlog = 4096, int min_interval = 0, int max_interval = 1000)
+                : backlog(backlog), min_interval(min_interval), max_interval(max_interval), interval_(min_interval) {}
+
+            // Return true if a frame may be written at now while queued bytes are unread
+            bool ready(Clock::time_point now, size_t queued) {
+                if(now < next) {
+                    return false;
+                }
+                if(queued > backlog) {
+                    slow_down(16);
+                    next = now + std::chrono::milliseconds(interval_);
+                    return false;
+                }
+                interval_ = std::max(interval_ - interval_ / 4 - 1, min_interval);
+                return true;
+            }
+
+            // Note a frame was written from start until end
+            void written(Clock::time_point start, Clock::time_point end) {
+                int blocked = (int)std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+                if(blocked >= stall) {
+                    // Leave the terminal at least as long to catch up before the next frame
+                    slow_down(blocked);
+                }
+                next = end + std::chrono::milliseconds(interval_);
+            }
+
+            // Return milliseconds from now until a held frame should be tried again
+            int next_timeout(Clock::time_point now) const {
+                if(now >= next) {
+                    return 0;
+                }
+                return (int)std::chrono::duration_cast<std::chrono::milliseconds>(next - now + std::chrono::microseconds(999)).count();
+            }
+
+            // Hold frames back while more than bytes are unread, with at least min_interval
+            // and at most max_interval milliseconds between frames, a held frame may be written at once
+            void configure(size_t bytes, int min_interval, int max_interval = 1000) {
+                backlog = bytes;
+                this->min_interval = std::max(min_interval, 0);
+                this->max_interval = std::max(max_interval, this->min_interval);
+                interval_ = std::min(std::max(interval_, this->min_interval), this->max_interval);
+                next = Clock::time_point();
+            }
+
+            // Return the current milliseconds between frames
+            inline int interval() const {
+                return interval_;
+            }
+
+            // Return the number of frames the terminal lagged behind
+            inline size_t lagged() const {
+                return lags;
+            }
+
+        private:
+            size_t backlog;   // Unread bytes allowed before holding frames
+            int min_interval; // Milliseconds between frames while the terminal keeps up
+            int max_interval;
+            int interval_;
+            Clock::time_point next; // Earliest time for the next frame
+            size_t lags = 0;
+
+            // Double the interval, to at least minimum milliseconds
+            inline void slow_down(int minimum) {
+                interval_ = std::min(std::max(interval_ * 2, minimum), max_interval);
+                lags++;
+            }
+    };
+
+    // Id of the widget drawn last at every cell, so mouse events find
+    // the widget under the pointer with one lookup
+    class HitMap {
+        public:
+            // Cover columns by rows cells showing no widget
+            void reset(int columns, int rows) {
+                columns_ = std::max(0, columns);
+                rows_ = std::max(0, rows);
+                ids.assign((size_t)columns_ * rows_, 0);
+            }
+
+            // Mark the cells of rect as showing widget id, cells outside the map are ignored
+            void mark(const Rect &rect, uint64_t id) {
+                Rect area = rect.intersect({0, 0, columns_, rows_});
+                for(int y = area.y; y < area.y + area.height; y++) {
+                    uint64_t *row = ids.data() + (size_t)y * columns_;
+                    std::fill(row + area.x, row + area.x + area.width, id);
+                }
+            }
+
+            // Return the id of the widget at x, y or 0 if there is none
+            inline uint64_t at(int x, int y) const {
+                if(x < 0 || x >= columns_ || y < 0 || y >= rows_) {
+                    return 0;
+                }
+                return ids[(size_t)y * columns_ + x];
+            }
+
+            inline int columns() const {
+                return columns_;
+            }
+
+            inline int rows() const {
+                return rows_;
+            }
+
+        private:
+            int columns_ = 0;
+            int rows_ = 0;
+            std::vector<uint64_t> ids;
+    };
+
+#ifdef IS_POSIX
+    // Decode terminal input bytes into events
+    // Bytes are kept in a fixed size buffer, decoding never allocates.
+    // Keys use the ncurses key codes so events match the previous getch() values.
+    class InputDecoder {
+        public:
+            static const size_t capacity = 256;
+
+            // Copy bytes into the buffer, return the number of bytes accepted
+            // Invalidates the text of previously decoded paste events
+            size_t feed(const char *bytes, size_t size) {
+                compact();
+                size_t count = std::min(size, capacity - end);
+                memcpy(buffer + end, bytes, count);
+                end += count;
+                return count;
+            }
+
+            // Return the number of bytes which can be fed
+            size_t space() {
+                compact();
+                return capacity - end;
+            }
+
+            // Return true if undecoded bytes remain
+            inline bool pending() const {
+                return start < end;
+            }
+
+            // Decode the next complete event
+            bool next(Event &event) {
+                while(start < end) {
+                    event = Event{};
+                    size_t used = in_paste ? decode_paste(event) : decode(buffer + start, end - start, event);
+                    if(used == 0) {
+                        if(start == 0 && end == capacity) {
+                            // Sequence can never complete, drop a byte
+                            start++;
+                            continue;
+                        }
+                        return false;
+                    }
+                    start += used;
+                    if(event.type != UNDEFINED) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            // Decode an incomplete sequence as plain keys
+            // Used once no more input arrived, e.g. after a lone escape key
+            bool flush(Event &event) {
+                if(start == end || in_paste) {
+                    return false;
+                }
+                event = Event{};
+                size_t used = decode_plain(buffer + start, 1, event);
+                start += std::max(used, (size_t)1);
+                return event.type != UNDEFINED;
+            }
+
+        private:
+            struct KeyEntry {
+                int code;
+                int key;
+            };
+
+            // Keys of "ESC [ <letter>" and "ESC O <letter>" sequences
+            static int letter_key(char letter) {
+                static const KeyEntry table[] = {
+                    {'A', KEY_UP}, {'B', KEY_DOWN}, {'C', KEY_RIGHT}, {'D', KEY_LEFT},
+                    {'H', KEY_HOME}, {'F', KEY_END}, {'Z', KEY_BTAB},
+                    {'P', KEY_F(1)}, {'Q', KEY_F(2)}, {'R', KEY_F(3)}, {'S', KEY_F(4)}
+                };
+                for(const KeyEntry &entry : table) {
+                    if(entry.code == letter) {
+                        return entry.key;
+                    }
+                }
+                return 0;
+            }
+
+            // Keys of "ESC [ <number> ~" sequences
+            static int tilde_key(int number) {
+                static const KeyEntry table[] = {
+                    {1, KEY_HOME}, {2, KEY_IC}, {3, KEY_DC}, {4, KEY_END},
+                    {5, KEY_PPAGE}, {6, KEY_NPAGE}, {7, KEY_HOME}, {8, KEY_END},
+                    {11, KEY_F(1)}, {12, KEY_F(2)}, {13, KEY_F(3)}, {14, KEY_F(4)},
+                    {15, KEY_F(5)}, {17, KEY_F(6)}, {18, KEY_F(7)}, {19, KEY_F(8)},
+                    {20, KEY_F(9)}, {21, KEY_F(10)}, {23, KEY_F(11)}, {24, KEY_F(12)}
+                };
+                for(const KeyEntry &entry : table) {
+                    if(entry.code == number) {
+                        return entry.key;
+                    }
+                }
+                return 0;
+            }
+
+            // Convert an xterm modifier parameter to modifier flags
+            static int modifier_flags(int parameter) {
+                int bits = parameter > 1 ? parameter - 1 : 0;
+                return (
+                    ((bits & 1) ? MOD_SHIFT : 0) |
+                    ((bits & 2) ? MOD_ALT : 0) |
+                    ((bits & 4) ? MOD_CTRL : 0)
+                );
+            }
+
+            // Move undecoded bytes to the front of the buffer
+            void compact() {
+                if(start > 0) {
+                    memmove(buffer, buffer + start, end - start);
+                    end -= start;
+                    start = 0;
+                }
+            }
+
+            // Decode a single event at bytes, return the bytes used or 0 if incomplete
+            size_t decode(const char *bytes, size_t size, Event &event) {
+                if(bytes[0] != 0x1B) {
+                    return decode_plain(bytes, size, event);
+                }
+                if(size == 1) {
+                    return 0;
+                }
+                if(bytes[1] == '[') {
+                    return decode_csi(bytes, size, event);
+                }
+                if(bytes[1] == 'O') {
+                    if(size < 3) {
+                        return 0;
+                    }
+                    int key = letter_key(bytes[2]);
+                    if(key != 0) {
+                        event.type = KEYDOWN;
+                        event.key = key;
+                    }
+                    return 3;
+                }
+                // Escape followed by a key is the key with alt held
+                size_t used = decode_plain(bytes + 1, size - 1, event);
+                if(used == 0) {
+                    return 0;
+                }
+                event.modifiers |= MOD_ALT;
+                return used + 1;
+            }
+
+            // Decode a key which is not an escape sequence
+            size_t decode_plain(const char *bytes, size_t size, Event &event) {
+                unsigned char c = bytes[0];
+                event.type = KEYDOWN;
+                if(c < 0x80) {
+                    if(c == 0x7F || c == 0x08) {
+                        event.key = KEY_BACKSPACE;
+                    } else if(c == '\r') {
+                        event.key = '\n';
+                    } else {
+                        event.key = c;
+                        if(c < 0x1B && c != '\t' && c != '\n') {
+                            event.modifiers = MOD_CTRL;
+                        }
+                    }
+                    return 1;
+                }
+                // UTF-8 sequence
+                size_t length = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+                if(size < length) {
+                    return 0;
+                }
+                int codepoint = length == 1 ? c : c & (0x7F >> length);
+                for(size_t i = 1; i < length; i++) {
+                    codepoint = (codepoint << 6) | (bytes[i] & 0x3F);
+                }
+                event.key = codepoint;
+                return length;
+            }
+
+            // Decode "ESC [" control sequences
+            size_t decode_csi(const char *bytes, size_t size, Event &event) {
+                const size_t maximum_length = 32;
+                int parameters[4] = {0, 0, 0, 0};
+                int count = 0;
+                char prefix = 0;
+                size_t i = 2;
+                if(i < size && (bytes[i] == '<' || bytes[i] == '?' || bytes[i] == '>' || bytes[i] == '=')) {
+                    prefix = bytes[i++];
+                }
+                for(; i < size && i < maximum_length; i++) {
+                    char c = bytes[i];
+                    if(c >= '0' && c <= '9') {
+                        if(count < 4) {
+                            parameters[count] = parameters[count] * 10 + (c - '0');
+                        }
+                    } else if(c == ';' || c == ':') {
+                        count++;
+                    } else if(c >= 0x40 && c <= 0x7E) {
+                        break;
+                    }
+                }
+                if(i == maximum_length) {
+                    // Unterminated sequence, discard it
+                    return i;
+                }
+                if(i == size) {
+                    return 0;
+                }
+                char final = bytes[i];
+                size_t used = i + 1;
+                if(prefix == '<' && (final == 'M' || final == 'm')) {
+                    decode_mouse(parameters, final == 'M', event);
+                } else if(prefix != 0) {
+                    // Unsupported private sequence
+                } else if(final == '~') {
+                    if(parameters[0] == 200) {
+                        in_paste = true;
+                    } else if(int key = tilde_key(parameters[0])) {
+                        event.type = KEYDOWN;
+                        event.key = key;
+                        event.modifiers = modifier_flags(parameters[1]);
+                    }
+                } else if(final == 'I' && count == 0) {
+                    event.type = FOCUSIN;
+                } else if(final == 'O' && count == 0) {
+                    event.type = FOCUSOUT;
+                } else if(int key = letter_key(final)) {
+                    event.type = KEYDOWN;
+                    event.key = key;
+                    event.modifiers = modifier_flags(parameters[1]);
+                }
+                return used;
+            }
+
+            // Decode SGR (1006) mouse report "ESC [ < button ; x ; y M/m"
+            void decode_mouse(const int parameters[4], bool pressed, Event &event) {
+                int code = parameters[0];
+                event.x = parameters[1] - 1;
+                event.y = parameters[2] - 1;
+                event.modifiers = (
+                    ((code & 4) ? MOD_SHIFT : 0) |
+                    ((code & 8) ? MOD_ALT : 0) |
+                    ((code & 16) ? MOD_CTRL : 0)
+                );
+                int button = (code & 3) == 3 ? BUTTON_NONE : (code & 3) + 1;
+                if(code & 64) {
+                    if((code & 2) == 0) {
+                        // Horizontal wheel reports are ignored
+                        event.type = MOUSEWHEEL;
+                        event.wheel = (code & 1) ? 1 : -1;
+                    }
+                } else if(code & 32) {
+                    event.type = MOUSEMOTION;
+                    event.button = button;
+                } else {
+                    event.type = pressed ? MOUSEBUTTONDOWN : MOUSEBUTTONUP;
+                    event.button = button;
+                }
+            }
+
+            // Emit pasted text until the bracketed paste end marker
+            size_t decode_paste(Event &event) {
+                static const char marker[] = "\x1B[201~";
+                const size_t marker_length = sizeof(marker) - 1;
+                size_t size = end - start;
+                const char *bytes = buffer + start;
+                for(size_t i = 0; i < size; i++) {
+                    size_t matched = 0;
+                    while(matched < marker_length && i + matched < size && bytes[i + matched] == marker[matched]) {
+                        matched++;
+                    }
+                    if(matched == marker_length && i == 0) {
+                        in_paste = false;
+                        return marker_length;
+                    }
+                    if(matched == marker_length || (matched > 0 && i + matched == size)) {
+                        // Text up to a (possibly partial) end marker
+                        if(i == 0) {
+                            return 0;
+                        }
+                        size = i;
+                        break;
+                    }
+                }
+                event.type = PASTE;
+                event.text = bytes;
+                event.length = size;
+                return size;
+            }
+
+            char buffer[capacity];
+            size_t start = 0;      // First undecoded byte
+            size_t end = 0;        // End of buffered bytes
+            bool in_paste = false; // Inside a bracketed paste
+    };
+
+    // Writes stdout to the terminal from a thread so writes never block the caller
+    // stdout is redirected to a pipe which the thread drains into memory, then writes
+    // the bytes to the terminal without blocking. curses keeps setting up the terminal
+    // itself, only its output goes through the pipe.
+    class TerminalWriter {
+        public:
+            TerminalWriter() = default;
+            TerminalWriter(const TerminalWriter &) = delete;
+            TerminalWriter &operator=(const TerminalWriter &) = delete;
+
+            ~TerminalWriter() {
+                stop();
+            }
+
+            // Redirect stdout and start the thread, returns false if stdout stays as it was
+            bool start() {
+                if(thread.joinable()) {
+                    return true;
+                }
+                int fds[2];
+                if(pipe(fds) != 0) {
+                    return false;
+                }
+                fflush(stdout);
+                terminal = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 0);
+                if(terminal < 0) {
+                    ::close(fds[0]);
+                    ::close(fds[1]);
+                    return false;
+                }
+                // A terminal is opened again, so writing without blocking does not affect stdin
+                output = -1;
+                const char *name = isatty(terminal) ? ttyname(terminal) : nullptr;
+                if(name != nullptr) {
+                    output = ::open(name, O_WRONLY | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+                }
+                if(output < 0) {
+                    output = terminal;
+                    flags = fcntl(output, F_GETFL);
+                    fcntl(output, F_SETFL, flags | O_NONBLOCK);
+                }
+                reader = fds[0];
+                fcntl(reader, F_SETFD, FD_CLOEXEC);
+                dup2(fds[1], STDOUT_FILENO);
+                ::close(fds[1]);
+                thread = std::thread(&TerminalWriter::run, this);
+                return true;
+            }
+
+            // Write everything left and give stdout back
+            void stop() {
+                if(!thread.joinable()) {
+                    return;
+                }
+                fflush(stdout);
+                // Closes the last write end of the pipe, the thread stops once the rest is written
+                dup2(terminal, STDOUT_FILENO);
+                thread.join();
+                ::close(reader);
+                if(output != terminal) {
+                    ::close(output);
+                } else {
+                    fcntl(terminal, F_SETFL, flags);
+                }
+                ::close(terminal);
+                terminal = output = reader = -1;
+                unwritten_ = 0;
+            }
+
+            // Return the bytes written to stdout which the terminal did not take yet
+            size_t unwritten() const {
+                int piped = 0;
+                if(reader < 0 || ioctl(reader, FIONREAD, &piped) != 0 || piped < 0) {
+                    piped = 0;
+                }
+                return unwritten_.load() + (size_t)piped;
+            }
+
+            // Return the original stdout, e.g. to query the terminal size
+            inline int terminal_fd() const {
+                return terminal >= 0 ? terminal : STDOUT_FILENO;
+            }
+
+        private:
+            int terminal = -1; // Original stdout
+            int output = -1;   // Non-blocking descriptor of the terminal
+            int reader = -1;   // Read end of the pipe stdout was redirected to
+            int flags = 0;     // File status flags of terminal when it is written to directly
+            std::atomic<size_t> unwritten_{0};
+            std::thread thread;
+
+            void run() {
+                std::vector<char> buffer(1 << 16);
+                std::string queue;
+                size_t start = 0;
+                bool open = true;
+                while(open || start < queue.size()) {
+                    pollfd fds[2];
+                    int count = 0;
+                    int read_index = -1;
+                    int write_index = -1;
+                    if(open) {
+                        fds[count] = {reader, POLLIN, 0};
+                        read_index = count++;
+                    }
+                    if(start < queue.size()) {
+                        fds[count] = {output, POLLOUT, 0};
+                        write_index = count++;
+                    }
+                    if(poll(fds, count, -1) < 0) {
+                        if(errno == EINTR) {
+                            continue;
+                        }
+                        break;
+                    }
+                    if(read_index >= 0 && fds[read_index].revents != 0) {
+                        ssize_t got = read(reader, buffer.data(), buffer.size());
+                        if(got > 0) {
+                            queue.append(buffer.data(), (size_t)got);
+                            unwritten_ += (size_t)got;
+                        } else if(got == 0 || errno != EINTR) {
+                            open = false;
+                        }
+                    }
+                    if(write_index >= 0 && fds[write_index].revents != 0) {
+                        ssize_t written = write(output, queue.data() + start, queue.size() - start);
+                        if(written > 0) {
+                            start += (size_t)written;
+                            unwritten_ -= (size_t)written;
+                        } else if(written < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                            // The terminal is gone, drop what it will never read
+                            unwritten_ -= queue.size() - start;
+                            start = queue.size();
+                        }
+                    }
+                    if(start == queue.size()) {
+                        queue.clear();
+                        start = 0;
+                    } else if(start >= buffer.size() && start * 2 >= queue.size()) {
+                        queue.erase(0, start);
+                        start = 0;
+                    }
+                }
+            }
+    };
+#endif
+
+    class Window {
+        public:
+            StyleTable styles; // Styles of the cells, draw_char takes their ids as colors
+
+            // Updates width, height, rows, and columns values
+            void update_dimensions() {
+                window_width = width();
+                window_height = height();
+                rows_ = rows();
+                columns_ = columns();
+            }
+
+            // Draw border with given widget dimensions
+            template<typename Widget>
+            void draw_border(const Widget &widget) {
+                DrawContext<Window> context = context_for(widget.rect());
+                paint_border(context, widget);
+            }
+
+            // Draw title
+            template<typename Widget>
+            void draw_title(const Widget &widget) {
+                DrawContext<Window> context = context_for(widget.rect());
+                paint_title(context, widget);
+            }
+
+            // Return drawing context of rect clipped to the window and the current clip
+            DrawContext<Window> context_for(const Rect &rect) {
+                return DrawContext<Window>(*this, clip().intersect(rect), &styles);
+            }
+
+            // Return the area widgets may draw in
+            Rect clip() const {
+                Rect screen = {0, 0, columns_, rows_};
+                return clips.empty() ? screen : clips.back().intersect(screen);
+            }
+
+            // Restrict drawing to rect within the current clip
+            void push_clip(const Rect &rect) {
+                clips.push_back(clips.empty() ? rect : clips.back().intersect(rect));
+            }
+
+            // Restore the clip before the last push_clip
+            void pop_clip() {
+                if(!clips.empty()) {
+                    clips.pop_back();
+                }
+            }
+
+            // Attach a sink which receives every rendered frame
+            void attach(FrameSink &sink) {
+                sinks.push_back(&sink);
+            }
+
+            // Stop sending frames to sink
+            void detach(FrameSink &sink) {
+                sinks.erase(std::remove(sinks.begin(), sinks.end(), &sink), sinks.end());
+            }
+
+            // Poll every pending event into events and return the number of events
+            // With coalesce, bursts of wheel, motion and resize events are merged
+            // so a burst of input can be handled with a single render
+            size_t poll_events(Event *events, size_t capacity, bool coalesce = true) {
+                size_t count = 0;
+                bool more = true;
+                while(more) {
+                    while(count < capacity && (more = poll_event(events[count]))) {
+                        count++;
+                    }
+                    if(!coalesce) {
+                        break;
+                    }
+                    size_t merged = coalesce_events(events, count);
+                    if(merged == count) {
+                        break;
+                    }
+                    count = merged;
+                }
+                return count;
+            }
+
+            template<size_t N>
+            inline size_t poll_events(Event (&events)[N], bool coalesce = true) {
+                return poll_events(events, N, coalesce);
+            }
+
+            // Wait up to timeout milliseconds for an event, forever if timeout is -1
+            // Due timers run while waiting and the wait ends early when they fire or on wake().
+            // Returns false when timers fired, the window was woken or the timeout passed, the caller should render
+            bool wait_event(Event &event, int timeout = -1) {
+                TimerWheel::Clock::time_point end = TimerWheel::Clock::now() + std::chrono::milliseconds(timeout);
+                while(true) {
+                    TimerWheel::Clock::time_point now = TimerWheel::Clock::now();
+                    bool fired = timers.advance(now) > 0;
+                    if(read_event(event)) {
+                        track_input(event);
+                        return true;
+                    }
+                    if(fired) {
+                        return false;
+                    }
+                    int wait = timers.next_timeout(now);
+#ifdef IS_POSIX
+                    if(held && !flush()) {
+                        int retry = pacer.next_timeout(TimerWheel::Clock::now());
+                        wait = (wait < 0) ? retry : std::min(wait, retry);
+                    }
+#endif
+                    if(timeout >= 0) {
+                        int left = (int)std::chrono::duration_cast<std::chrono::milliseconds>(end - now).count();
+                        if(left <= 0) {
+                            return false;
+                        }
+                        wait = (wait < 0) ? left : std::min(wait, left);
+                    }
+                    if(wait_input(wait)) {
+                        return false;
+                    }
+                }
+            }
+
+            // Call callback from the event loop after delay milliseconds
+            TimerWheel::TimerId set_timeout(int delay, std::function<void()> callback) {
+                return timers.schedule(delay, std::move(callback));
+            }
+
+            // Call callback from the event loop every interval milliseconds
+            TimerWheel::TimerId set_interval(int interval, std::function<void()> callback) {
+                return timers.schedule(interval, std::move(callback), interval);
+            }
+
+            // Stop a timeout, interval or animation
+            bool cancel_timer(TimerWheel::TimerId id) {
+                return timers.cancel(id);
+            }
+
+            // Move value linearly to target over duration milliseconds, updating every frame milliseconds
+            // value must outlive the animation, e.g. Gauge::percent or an element of BarChart::data.
+            // Widgets are redrawn by adding them again after wait_event returns
+            TimerWheel::TimerId animate(int &value, int target, int duration, int frame = 16) {
+                std::shared_ptr<TimerWheel::TimerId> id = std::make_shared<TimerWheel::TimerId>(0);
+                int from = value;
+                TimerWheel::Clock::time_point start = TimerWheel::Clock::now();
+                *id = timers.schedule(frame, [this, &value, from, target, duration, start, id]() {
+                    long long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(TimerWheel::Clock::now() - start).count();
+                    if(elapsed >= duration) {
+                        value = target;
+                        timers.cancel(*id);
+                    } else {
+                        value = from + (int)((long long)(target - from) * elapsed / duration);
+                    }
+                }, frame);
+                return *id;
+            }
+
+            // Copy the cells of surface to its origin, or to x and y
+            void blit(const Surface &surface) {
+                blit(surface, surface.bounds().x, surface.bounds().y);
+            }
+
+            void blit(const Surface &surface, int x, int y) {
+                TimerWheel::Clock::time_point start = begin_raster();
+                Rect area = clip().intersect({x, y, surface.columns(), surface.rows()});
+                bool restyle = surface.styles.size() > StyleTable::plain_styles;
+                for(int i = area.y; i < area.y + area.height; i++) {
+                    const Cell *cells = surface.row(i - y) + (area.x - x);
+                    if(restyle) {
+                        // Styles of the surface may have other ids in the window
+                        restyled.assign(cells, cells + area.width);
+                        for(Cell &cell : restyled) {
+                            cell.color = styles.import(surface.styles, cell.color);
+                        }
+                        cells = restyled.data();
+                    }
+                    blit_row(area.x, i, cells, area.width);
+                }
+                end_raster(start);
+            }
+
+            // Draw widget into cache only when its fingerprint changed, then blit the cache
+            // Like the widget cache this relies on content being changed through setters
+            template<typename Widget>
+            void add_cached(const Widget &widget, Surface &cache) {
+                uint64_t fingerprint = widget.fingerprint();
+                if(cache.fingerprint != fingerprint) {
+                    cache.reset(widget.rect());
+                    cache.add(widget);
+                    cache.fingerprint = fingerprint;
+                }
+                blit(cache);
+                mark_hit(widget.rect(), widget.id);
+            }
+
+            // Skip adding widgets whose fingerprint did not change since they were last added
+            // Only enable if widget content is changed through setters or touch()
+            // and widgets do not overlap
+            void set_widget_cache(bool enabled) {
+                widget_cache = enabled;
+                fingerprints.clear();
+                paint_states.clear();
+            }
+
+            // Forget cached fingerprints so every widget is drawn again
+            void invalidate() {
+                fingerprints.clear();
+                paint_states.clear();
+            }
+
+            // Measure the latency of every event from reading its input
+            // until the next render() wrote a frame, see latency()
+            void set_latency_tracking(bool enabled) {
+                latency_tracking = enabled;
+                inputs.clear();
+                raster_time = TimerWheel::Clock::duration::zero();
+            }
+
+            // Return latencies measured while tracking
+            inline LatencyStats &latency() {
+                return latency_stats;
+            }
+
+            // Return the id of the widget last drawn at x, y or 0, e.g. to dispatch mouse events
+            inline uint64_t widget_at(int x, int y) const {
+                return hits.at(x, y);
+            }
+
+            // Report mouse motion without a pressed button, e.g. for hover highlights
+            // The Windows console always reports it
+            void set_mouse_hover(bool enabled) {
+#ifdef IS_POSIX
+                // Any event tracking (1003) instead of drag tracking (1002)
+                fputs(enabled ? "\x1B[?1003h" : "\x1B[?1003l", stdout);
+                fflush(stdout);
+#endif
+                (void)enabled;
+            }
+
+            // Return the pacer of frames written to the terminal, see OutputPacer::configure()
+            // The Windows console is written synchronously and never holds frames
+            inline OutputPacer &output_pacer() {
+                return pacer;
+            }
+
+            // Draw the widgets of one add() call on threads threads, one per hardware thread if 0
+            // Each widget is drawn into its own buffer by a work stealing pool and the buffers
+            // are copied to the window in order, so frames are the same as when drawn serially.
+            // 1 draws every widget on the calling thread.
+            void set_raster_threads(unsigned threads) {
+                if(threads == 0) {
+                    threads = std::max(1u, std::thread::hardware_concurrency());
+                }
+                raster_pool.reset(threads > 1 ? new detail::WorkStealingPool(threads) : nullptr);
+            }
+
+            // Return true if widget is cached and unchanged, otherwise remember it
+            template<typename Widget>
+            bool skip_unchanged(const Widget &widget) {
+                if(widget_cache == false) {
+                    return false;
+                }
+                uint64_t fingerprint = widget.fingerprint();
+                auto found = fingerprints.find(widget.id);
+                if(found != fingerprints.end() && found->second == fingerprint) {
+                    return true;
+                }
+                fingerprints[widget.id] = fingerprint;
+                return false;
+            }
+
+            // Queue widgets to be drawn by layer when the frame is composed
+            // Widgets on the same layer are drawn in the order they were stacked
+            template<typename Widget, typename ... Rest>
+            void stack(const Widget &first, const Rest &... rest) {
+                layers.push_back({first.rect(), first.layer, first.opaque, first.id, [this, first]() {
+                    add(first);
+                }});
+                (stack(rest), ...);
+            }
+
+            // Draw stacked widgets from the top layer down
+            // Every cell is drawn only by the topmost widget drawing it,
+            // widgets covered by an opaque widget are skipped entirely
+            void compose() {
+                if(layers.empty()) {
+                    return;
+                }
+                // Topmost first, later stacked widgets are above earlier ones
+                std::stable_sort(layers.begin(), layers.end(), [](const Layer &layer1, const Layer &layer2) {
+                    return layer1.layer < layer2.layer;
+                });
+                std::reverse(layers.begin(), layers.end());
+                owners.assign(columns_ * rows_, 0);
+                // Layers may cover cells of widgets drawn as deltas
+                paint_states.clear();
+                bool cache = widget_cache;
+                widget_cache = false;
+                Rect screen = {0, 0, columns_, rows_};
+                std::vector<Rect> covered;
+                std::vector<bool> drawn(layers.size(), false);
+                for(size_t i = 0; i < layers.size(); i++) {
+                    Rect visible = layers[i].rect.intersect(screen);
+                    bool occluded = visible.empty() || std::any_of(covered.begin(), covered.end(), [&](const Rect &rect) {
+                        return rect.contains(visible);
+                    });
+                    if(occluded) {
+                        continue;
+                    }
+                    drawn[i] = true;
+                    owner = (uint32_t)(i + 1);
+                    layers[i].draw();
+                    if(layers[i].opaque) {
+                        // Blank cells the widget did not draw
+                        for(int y = visible.y; y < visible.y + visible.height; y++) {
+                            for(int x = visible.x; x < visible.x + visible.width; x++) {
+                                if(owners[y * columns_ + x] == 0) {
+                                    draw_char(x, y, ' ');
+                                }
+                            }
+                        }
+                        covered.push_back(visible);
+                    }
+                }
+                owner = 0;
+                widget_cache = cache;
+                // Upper layers are marked last so they own the cells they share
+                for(size_t i = layers.size(); i-- > 0;) {
+                    if(drawn[i]) {
+                        mark_hit(layers[i].rect, layers[i].id);
+                    }
+                }
+                layers.clear();
+            }
+
+            // Draw rows first_row to last_row (exclusive) of the inner area of list
+            void draw_list_rows(const List &list, int first_row, int last_row);
+
+            // Scroll a displayed list by lines and draw only the exposed rows
+            void scroll_list(const List &list, int lines);
+
+            // Run the refresh of the active pane and draw the tabs and the surface of the pane
+            // Unlike widgets pane stacks are added on their own
+            void add(PaneStack &panes);
+
+            // Draw the rows of a displayed list showing elements previous and current,
+            // e.g. after the selection moved from previous to current
+            void redraw_list_elements(const List &list, int previous, int current);
+
+            // Add one or more widgets to the window
+            // Each widget is forwarded to its specialization with a fold expression,
+            // or drawn on the raster threads, see set_raster_threads()
+            template<typename Widget, typename ... Rest>
+            inline void add(const Widget &first, const Rest &... rest) {
+                if constexpr(sizeof...(Rest) > 0 && detail::is_paintable<Widget>::value && (detail::is_paintable<Rest>::value && ...)) {
+                    if(raster_pool) {
+                        queue_raster(first);
+                        (queue_raster(rest), ...);
+                        run_raster();
+                        return;
+                    }
+                }
+                add(first);
+                (add(rest), ...);
+            }
+
+            // Add every widget of a static scene
+            // Dispatch is resolved at compile time for each tuple element
+            template<typename ... Widgets>
+            inline void add(const StaticScene<Widgets...> &scene) {
+                std::apply([this](const Widgets &... widgets) {
+                    add(widgets...);
+                }, scene.widgets);
+            }
+
+            // Add every widget of widgets in order
+            template<typename Widget>
+            void add(const std::vector<Widget> &widgets) {
+                if constexpr(detail::is_paintable<Widget>::value) {
+                    if(raster_pool && widgets.size() > 1) {
+                        for(const Widget &widget : widgets) {
+                            queue_raster(widget);
+                        }
+                        run_raster();
+                        return;
+                    }
+                }
+                for(const Widget &widget : widgets) {
+                    add(widget);
+                }
+            }
+
+#ifdef IS_WIN
+            Window(int window_width_ = 0, int window_height_ = 0) : window_width((LONG)window_width_), window_height((LONG)window_height_) {
+                // Resize console to window_width and window_height
+                console = GetConsoleWindow();
+                // Get default dimensions
+                default_width = width();
+                default_height = height();
+                // Check if no width and height was given
+                if(window_width_ <= 0 || window_height_ < 0) {
+                    // Window width or height given is 0 or less
+                    // Use default dimensions
+                    window_width = default_width;
+                    window_height = default_height;
+                }
+                RECT r;
+                GetWindowRect(console, &r);
+                MoveWindow(console, r.left, r.top, window_width, window_height, TRUE);
+                // Receive mouse input instead of quick edit selection
+                GetConsoleMode(input_handle, &default_input_mode);
+                SetConsoleMode(input_handle, ENABLE_EXTENDED_FLAGS | ENABLE_WINDOW_INPUT | ENABLE_MOUSE_INPUT);
+                // Tidy up the window
+                hide_cursor();
+                remove_scrollbar();
+                update_dimensions();
+                // Allocate memory for content
+                content = new CHAR_INFO[columns_ * rows_];
+                memset(content, 0, sizeof(CHAR_INFO) * rows_ * columns_);
+            }
+
+            // Close the tui and revert to default settings
+            void close() {
+                clear();
+                // Render the cleared content
+                render();
+                // Show the cursor
+                show_cursor();
+                RECT r;
+                GetWindowRect(console, &r);
+                MoveWindow(console, r.left, r.top, default_width, default_height, TRUE);
+                SetConsoleMode(input_handle, default_input_mode);
+            }
+
+            ~Window() {
+                CloseHandle(wake_event);
+            }
+
+            // Interrupt wait_event from any thread
+            void wake() {
+                SetEvent(wake_event);
+            }
+
+            // Remove scrollbar from console
+            void remove_scrollbar() {
+                GetConsoleScreenBufferInfo(handle, &csbi);
+                COORD new_size = {
+                    (short)(csbi.srWindow.Right - csbi.srWindow.Left + 1),
+                    (short)(csbi.srWindow.Bottom - csbi.srWindow.Top + 1)
+                };
+                SetConsoleScreenBufferSize(handle, new_size);
+            }
+
+            // Clear content
+            inline void clear() { 
+                // Set content to ' '
+                memset(content, 0, sizeof(CHAR_INFO) * rows_ * columns_);
+                invalidate();
+                hits.reset(columns_, rows_);
+            }
+
+            // Hide cursor from console
+            void hide_cursor() {
+                CONSOLE_CURSOR_INFO info;
+                info.bVisible = FALSE;
+                info.dwSize = 100;
+                SetConsoleCursorInfo(handle, &info);
+            }
+
+            // Show cursor from console
+            void show_cursor() {
+                CONSOLE_CURSOR_INFO info;
+                info.bVisible = TRUE;
+                SetConsoleCursorInfo(handle, &info);
+            }
+
+            // Return width of window
+            LONG width() {
+                RECT r;
+                GetWindowRect(console, &r);
+                return r.right - r.left;
+            }
+
+            // Return height of window
+            LONG height() {
+                RECT r;
+                GetWindowRect(console, &r);
+                return r.bottom - r.top;
+            }
+
+            // Return number of columns
+            short columns() {
+                GetConsoleScreenBufferInfo(handle, &csbi);
+                return csbi.srWindow.Right - csbi.srWindow.Left;
+            }
+
+            // Return number of rows
+            short rows() {
+                GetConsoleScreenBufferInfo(handle, &csbi);
+                return csbi.srWindow.Bottom - csbi.srWindow.Top;
+            }
+
+            // Set window title
+            void set_title(std::string str) {
+                TCHAR new_title[MAX_PATH];
+                new_title[str.size()] = 0;
+                std::copy(str.begin(), str.end(), new_title);
+                SetConsoleTitle(new_title);
+            }
+
+            // Set character in content
+            void draw_char(int x, int y, char c, short color = 0x000F) {
+                if(x >= 0 && x < columns_ && y >= 0 && y < rows_) {
+                    put(x, y, c, color);
+                }
+            }
+
+            // Set color of a cell without changing its character
+            void draw_color(int x, int y, short color) {
+                if(x >= 0 && x < columns_ && y >= 0 && y < rows_) {
+                    put_color(x, y, color);
+                }
+            }
+
+            // Set character of a cell known to be inside the window
+            inline void put(int x, int y, char c, short color) {
+                if(claim(x, y)) {
+                    content[y * columns_ + x].Char.AsciiChar = c;
+                    content[y * columns_ + x].Attributes = console_attributes(color);
+                }
+            }
+
+            // Set color of a cell known to be inside the window
+            inline void put_color(int x, int y, short color) {
+                if(claim(x, y)) {
+                    content[y * columns_ + x].Attributes = console_attributes(color);
+                }
+            }
+
+            // Write count characters in one style to a row known to be inside the window
+            void put_text(int x, int y, const char *text, int count, short color) {
+                WORD attributes = console_attributes(color);
+                CHAR_INFO *destination = &content[y * columns_ + x];
+                for(int i = 0; i < count; i++) {
+                    if(claim(x + i, y)) {
+                        destination[i].Char.AsciiChar = text[i];
+                        destination[i].Attributes = attributes;
+                    }
+                }
+            }
+
+            // Copy count cells to a row known to be inside the window
+            void blit_row(int x, int y, const Cell *cells, int count) {
+                CHAR_INFO *destination = &content[y * columns_ + x];
+                for(int i = 0; i < count; i++) {
+                    if(claim(x + i, y)) {
+                        destination[i].Char.AsciiChar = cells[i].glyph;
+                        destination[i].Attributes = console_attributes(cells[i].color);
+                    }
+                }
+            }
+
+            // Move the cells of a region up by lines (down if negative)
+            // Only cells inside clip() move, rows exposed by the move keep their old content
+            // Return false if the region is not inside the window or nothing of it is inside clip()
+            bool scroll_rect(int x, int y, int width, int height, int lines) {
+                if(!clipped_scroll_region(x, y, width, height)) {
+                    return false;
+                }
+                if(lines > 0) {
+                    for(int i = y; i < y + height - lines; i++) {
+                        memcpy(&content[i * columns_ + x], &content[(i + lines) * columns_ + x], sizeof(CHAR_INFO) * width);
+                    }
+                } else {
+                    for(int i = y + height - 1; i >= y - lines; i--) {
+                        memcpy(&content[i * columns_ + x], &content[(i + lines) * columns_ + x], sizeof(CHAR_INFO) * width);
+                    }
+                }
+                return true;
+            }
+
+            // Render (print) content
+            void render() {
+                compose();
+                TimerWheel::Clock::time_point output_start = begin_raster();
+                SMALL_RECT sr = {0, 0, (short)(columns_ - 1), (short)(rows_ - 1)};
+                hide_cursor();
+                remove_scrollbar();
+                WriteConsoleOutput(handle, content, {columns_, rows_}, {0, 0}, &sr);
+                record_latency(output_start);
+                publish_frame();
+            }
+
+            // Copy the content into cells
+            void snapshot(std::vector<Cell> &cells) {
+                cells.resize(columns_ * rows_);
+                for(int i = 0; i < columns_ * rows_; i++) {
+                    cells[i].glyph = content[i].Char.AsciiChar;
+                    WORD attributes = content[i].Attributes;
+                    if(attributes < StyleTable::plain_styles) {
+                        cells[i].color = attributes;
+                    } else {
+                        auto found = attribute_styles.find(attributes);
+                        cells[i].color = found != attribute_styles.end() ? found->second : (attributes & 0xFF);
+                    }
+                }
+            }
+
+            // Poll for event
+            // Reads queued console input records instead of scanning key states
+            bool poll_event(Event &event) {
+                timers.advance(TimerWheel::Clock::now());
+                if(read_event(event)) {
+                    track_input(event);
+                    return true;
+                }
+                return false;
+            }
+
+            // Return the content of the buffer
+            inline CHAR_INFO * get_content() {
+                return content;
+            }
+#elif defined(IS_POSIX)
+            Window() {
+                initscr();
+                raw();
+                keypad(stdscr, TRUE);
+                noecho();
+                start_color();
+                hide_cursor();
+                // curses set up the terminal, from now on its output is written by a thread
+                writer.start();
+                update_dimensions();
+                timeout(1);
+                // Enable mouse drag (1002) with SGR coordinates (1006),
+                // focus reports (1004) and bracketed paste (2004)
+                fputs("\x1B[?1002h\x1B[?1006h\x1B[?1004h\x1B[?2004h", stdout);
+                fflush(stdout);
+                // Self pipe written by wake() to interrupt poll()
+                if(pipe(wake_pipe) == 0) {
+                    for(int fd : wake_pipe) {
+                        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                        fcntl(fd, F_SETFD, FD_CLOEXEC);
+                    }
+                } else {
+                    wake_pipe[0] = wake_pipe[1] = -1;
+                }
+            }
+
+            // Close the tui and revert to default settings
+            void close() {
+                fputs("\x1B[?2004l\x1B[?1004l\x1B[?1006l\x1B[?1003l\x1B[?1002l", stdout);
+                fflush(stdout);
+                show_cursor();
+                // Write what is left before curses restores the terminal
+                writer.stop();
+                endwin();
+            }
+
+            ~Window() {
+                if(wake_pipe[0] >= 0) {
+                    ::close(wake_pipe[0]);
+                    ::close(wake_pipe[1]);
+                }
+            }
+
+            // Interrupt wait_event from any thread
+            void wake() {
+                char byte = 0;
+                ssize_t written = write(wake_pipe[1], &byte, 1);
+                (void)written;
+            }
+
+            // Remove scrollbar from console (no op)
+            inline void remove_scrollbar() { };
+
+            // Clear content (no op), widgets are found again once they are drawn
+            inline void clear() {
+                hits.reset(columns_, rows_);
+            }
+
+            // Hide cursor from console
+            inline void hide_cursor() {
+                curs_set(0);
+            }
+
+            // Show cursor from console
+            inline void show_cursor() {
+                curs_set(1);
+            }
+
+            // Return width of window
+            short width() {
+                struct winsize size;
+                if(ioctl(writer.terminal_fd(), TIOCGWINSZ, &size) != 0) {
+                    return 0;
+                }
+                return size.ws_xpixel;
+            }
+
+            // Return height of window
+            short height() {
+                struct winsize size;
+                if(ioctl(writer.terminal_fd(), TIOCGWINSZ, &size) != 0) {
+                    return 0;
+                }
+                return size.ws_ypixel;
+            }
+
+            // Return number of columns, the size curses assumes if output is not a terminal
+            short columns() {
+                struct winsize size;
+                if(ioctl(writer.terminal_fd(), TIOCGWINSZ, &size) != 0) {
+                    return COLS;
+                }
+                return size.ws_col;
+            }
+
+            // Return number of rows
+            short rows() {
+                struct winsize size;
+                if(ioctl(writer.terminal_fd(), TIOCGWINSZ, &size) != 0) {
+                    return LINES;
+                }
+                return size.ws_row;
+            }
+
+            // Set window title (no op)
+            inline void set_title(std::string str){ };
+
+            // Set character in tui
+            inline void draw_char(int x, int y, char c, short color = 0x000F) {
+                if(x >= 0 && x < columns_ && y >= 0 && y < rows_) {
+                    put(x, y, c, color);
+                }
+            }
+
+            // Set character of a cell known to be inside the window
+            inline void put(int x, int y, char c, short color) {
+                if(claim(x, y)) {
+                    mvaddch(y, x, (unsigned char)c | curses_attributes(color));
+                }
+            }
+
+            // Set color of a cell known to be inside the window
+            inline void put_color(int x, int y, short color) {
+                if(claim(x, y)) {
+                    mvaddch(y, x, (mvinch(y, x) & A_CHARTEXT) | curses_attributes(color));
+                }
+            }
+
+            // Write count characters in one style to a row known to be inside the window
+            void put_text(int x, int y, const char *text, int count, short color) {
+                if(owner != 0) {
+                    for(int i = 0; i < count; i++) {
+                        put(x + i, y, text[i], color);
+                    }
+                    return;
+                }
+                chtype attributes = curses_attributes(color);
+                line.resize(count + 1);
+                for(int i = 0; i < count; i++) {
+                    line[i] = (unsigned char)text[i] | attributes;
+                }
+                line[count] = 0;
+                mvaddchnstr(y, x, line.data(), count);
+            }
+
+            // Copy count cells to a row known to be inside the window
+            void blit_row(int x, int y, const Cell *cells, int count) {
+                if(owner != 0) {
+                    for(int i = 0; i < count; i++) {
+                        put(x + i, y, cells[i].glyph, cells[i].color);
+                    }
+                    return;
+                }
+                line.resize(count + 1);
+                for(int i = 0; i < count; i++) {
+                    line[i] = (unsigned char)cells[i].glyph | curses_attributes(cells[i].color);
+                }
+                line[count] = 0;
+                mvaddchnstr(y, x, line.data(), count);
+            }
+
+            // Move the cells of a region up by lines (down if negative)
+            // Full width regions use the terminal scroll region (DECSTBM with
+            // index/reverse index), other regions move the cells in the virtual screen
+            // Only cells inside clip() move, rows exposed by the move keep their old content
+            // Return false if the region is not inside the window or nothing of it is inside clip()
+            bool scroll_rect(int x, int y, int width, int height, int lines) {
+                if(!clipped_scroll_region(x, y, width, height)) {
+                    return false;
+                }
+                if(x == 0 && width == columns_) {
+                    scrollok(stdscr, TRUE);
+                    setscrreg(y, y + height - 1);
+                    scrl(lines);
+                    setscrreg(0, rows_ - 1);
+                    scrollok(stdscr, FALSE);
+                    return true;
+                }
+                std::vector<chtype> line(width + 1);
+                if(lines > 0) {
+                    for(int i = y; i < y + height - lines; i++) {
+                        mvinchnstr(i + lines, x, line.data(), width);
+                        mvaddchnstr(i, x, line.data(), width);
+                    }
+                } else {
+                    for(int i = y + height - 1; i >= y - lines; i--) {
+                        mvinchnstr(i + lines, x, line.data(), width);
+                        mvaddchnstr(i, x, line.data(), width);
+                    }
+                }
+                return true;
+            }
+
+            // Render tui
+            // While the terminal lags behind the frame is held back, wait_event() and
+            // poll_event() write it once the terminal caught up. curses compares the
+            // screen with what it wrote last, so frames replaced meanwhile are never sent.
+            inline void render() {
+                compose();
+                if(!held) {
+                    held = true;
+                    held_since = begin_raster();
+                }
+                flush();
+                publish_frame();
+            }
+
+            // Copy the virtual screen into cells
+            void snapshot(std::vector<Cell> &cells) {
+                std::vector<chtype> line(columns_ + 1);
+                cells.resize(columns_ * rows_);
+                for(int i = 0; i < rows_; i++) {
+                    mvinchnstr(i, 0, line.data(), columns_);
+                    for(int j = 0; j < columns_; j++) {
+                        cells[i * columns_ + j].glyph = line[j] & A_CHARTEXT;
+                        auto found = attribute_styles.find(line[j] & ~A_CHARTEXT);
+                        cells[i * columns_ + j].color = found != attribute_styles.end() ? found->second : 0;
+                    }
+                }
+            }
+
+            // Poll for event
+            // Input is read from stdin and decoded without ncurses
+            bool poll_event(Event &event) {
+                timers.advance(TimerWheel::Clock::now());
+                if(held) {
+                    flush();
+                }
+                bool polled = read_event(event);
+                if(!polled) {
+                    wait_input(1);
+                    polled = read_event(event);
+                }
+                if(polled) {
+                    track_input(event);
+                }
+                return polled;
+            }
+
+            // Return the content of the buffer (no op)
+            inline void get_content(){ };
+#endif
+        private:
+            struct Layer {
+                Rect rect;
+                int layer;
+                bool opaque;
+                uint64_t id;
+                std::function<void()> draw;
+            };
+
+            std::vector<Rect> clips;      // Nested clip rectangles
+            std::vector<Layer> layers;    // Stacked widgets waiting to be composed
+            std::vector<uint32_t> owners; // Layer which drew each cell while composing
+            uint32_t owner = 0;           // Layer being composed, 0 when not composing
+
+            // Return true if the cell may be drawn by the current layer and claim it
+            // The cell must be inside the window
+            inline bool claim(int x, int y) {
+                if(owner == 0) {
+                    return true;
+                }
+                uint32_t &cell_owner = owners[y * columns_ + x];
+                if(cell_owner != 0 && cell_owner != owner) {
+                    return false;
+                }
+                cell_owner = owner;
+                return true;
+            }
+
+            bool widget_cache = false; // Skip unchanged widgets
+            std::unordered_map<uint64_t, uint64_t> fingerprints; // Fingerprint of widget ids when last added
+            std::unordered_map<uint64_t, PaintState> paint_states; // What widgets drawn as deltas last showed
+            HitMap hits;                    // Widget shown at every cell
+            std::vector<FrameSink *> sinks; // Receivers of rendered frames
+            std::vector<Cell> frame;        // Last frame sent to sinks
+            std::vector<Cell> restyled;     // Row of a blitted surface with styles of the window
+            TimerWheel timers;              // Timers run by the event loop
+
+            bool latency_tracking = false;
+            LatencyStats latency_stats;
+            struct Input {
+                EventType type;
+                TimerWheel::Clock::time_point read;      // Input was read
+                TimerWheel::Clock::time_point delivered; // Event was returned to the application
+            };
+            std::vector<Input> inputs; // Events returned since the last render
+            TimerWheel::Clock::duration raster_time = TimerWheel::Clock::duration::zero(); // Drawing since the last render
+            OutputPacer pacer;
+            std::unique_ptr<detail::WorkStealingPool> raster_pool; // Null when drawing serially
+            detail::RasterBatch raster_batch;
+
+            // Remember an event returned to the application until a frame shows it
+            inline void track_input(const Event &event) {
+                if(latency_tracking && inputs.size() < 4096) {
+                    inputs.push_back({event.type, event.time, TimerWheel::Clock::now()});
+                }
+            }
+
+            // Return the start of drawing when tracking latency
+            inline TimerWheel::Clock::time_point begin_raster() const {
+                return latency_tracking ? TimerWheel::Clock::now() : TimerWheel::Clock::time_point();
+            }
+
+            inline void end_raster(TimerWheel::Clock::time_point start) {
+                if(latency_tracking) {
+                    raster_time += TimerWheel::Clock::now() - start;
+                }
+            }
+
+            // Mark the cells of rect within the clip as showing widget id
+            // Layers are marked once composed
+            // Reduce a region to move to the part inside clip(), returns false if it cannot move
+            // Moving cells ignores the claims of layers, so nothing moves while composing
+            bool clipped_scroll_region(int &x, int &y, int &width, int &height) const {
+                if(x < 0 || y < 0 || width <= 0 || height <= 0 || x + width > columns_ || y + height > rows_ || owner != 0) {
+                    return false;
+                }
+                Rect area = clip().intersect({x, y, width, height});
+                if(area.empty()) {
+                    return false;
+                }
+                x = area.x;
+                y = area.y;
+                width = area.width;
+                height = area.height;
+                return true;
+            }
+
+            // Return true if every cell of rect is inside clip() and showed widget id when last drawn
+            // Cells covered by other widgets, e.g. stacked above, must not be moved with it
+            bool shows(const Rect &rect, uint64_t id) const {
+                if(!clip().contains(rect) || hits.columns() != columns_ || hits.rows() != rows_) {
+                    return false;
+                }
+                for(int y = rect.y; y < rect.y + rect.height; y++) {
+                    for(int x = rect.x; x < rect.x + rect.width; x++) {
+                        if(hits.at(x, y) != id) {
+                            return false;
+                        }
+                    }
+                }
+                return true;
+            }
+
+            void mark_hit(const Rect &rect, uint64_t id) {
+                if(owner != 0) {
+                    return;
+                }
+                if(hits.columns() != columns_ || hits.rows() != rows_) {
+                    hits.reset(columns_, rows_);
+                }
+                hits.mark(clip().intersect(rect), id);
+            }
+
+            // Queue widget to be drawn by the raster threads unless the widget cache skips it
+            template<typename Widget>
+            void queue_raster(const Widget &widget) {
+                mark_hit(widget.rect(), widget.id);
+                if(!skip_unchanged(widget)) {
+                    // Drawn in full
+                    paint_states.erase(widget.id);
+                    raster_batch.queue(widget, clip());
+                }
+            }
+
+            // Draw the queued widgets
+            void run_raster() {
+                TimerWheel::Clock::time_point start = begin_raster();
+                raster_batch.run(*raster_pool, *this, &styles);
+                end_raster(start);
+            }
+
+            // Draw widget unless the widget cache skips it
+            template<typename Widget>
+            void paint_widget(const Widget &widget) {
+                mark_hit(widget.rect(), widget.id);
+                if(skip_unchanged(widget)) {
+                    return;
+                }
+                TimerWheel::Clock::time_point start = begin_raster();
+                DrawContext<Window> context = context_for(widget.rect());
+                paint(context, widget);
+                end_raster(start);
+            }
+
+            // Draw only the cells of widget that changed since it was last added when the widget cache is on
+            template<typename Widget>
+            void paint_widget_changes(const Widget &widget) {
+                if(widget_cache == false) {
+                    paint_widget(widget);
+                    return;
+                }
+                mark_hit(widget.rect(), widget.id);
+                if(skip_unchanged(widget)) {
+                    return;
+                }
+                TimerWheel::Clock::time_point start = begin_raster();
+                DrawContext<Window> context = context_for(widget.rect());
+                paint_changes(context, widget, paint_states[widget.id]);
+                end_raster(start);
+            }
+
+            // Record the latency of every event handled by the frame written since output_start
+            void record_latency(TimerWheel::Clock::time_point output_start) {
+                if(!latency_tracking) {
+                    return;
+                }
+                TimerWheel::Clock::time_point written = TimerWheel::Clock::now();
+                auto microseconds = [](TimerWheel::Clock::duration duration) {
+                    return std::chrono::duration<double, std::micro>(duration).count();
+                };
+                for(const Input &input : inputs) {
+                    // Events returned while a held frame waited count from their delivery
+                    TimerWheel::Clock::time_point start = std::max(output_start, input.delivered);
+                    double output = microseconds(written - start);
+                    double handling = microseconds(start - input.delivered);
+                    // Drawing before the event was returned belongs to an earlier event
+                    double raster = std::min(microseconds(raster_time), handling);
+                    const double durations[LatencyStats::phases] = {
+                        microseconds(input.delivered - input.read), handling - raster, raster, output,
+                        microseconds(written - input.read)
+                    };
+                    latency_stats.record(input.type, durations);
+                }
+                inputs.clear();
+                raster_time = TimerWheel::Clock::duration::zero();
+            }
+
+            // Send the current frame to every attached sink
+            void publish_frame() {
+                if(sinks.empty()) {
+                    return;
+                }
+                snapshot(frame);
+                for(FrameSink *sink : sinks) {
+                    sink->submit(frame.data(), columns_, rows_, &styles);
+                }
+            }
+#ifdef IS_WIN
+            HANDLE handle = GetStdHandle(STD_OUTPUT_HANDLE);
+            HANDLE input_handle = GetStdHandle(STD_INPUT_HANDLE);
+            DWORD default_input_mode; // Console input mode before tui started
+            HANDLE wake_event = CreateEvent(NULL, FALSE, FALSE, NULL); // Signalled by wake()
+            CONSOLE_SCREEN_BUFFER_INFO csbi;
+            HWND console;
+            LONG window_width; // Width of window
+            LONG window_height; // Height of window
+            short columns_;
+            short rows_;
+            CHAR_INFO *content; // Content to be rendered to buffer
+            LONG default_width; // Width of the window before tui started
+            LONG default_height; // Height of the window before tui started
+            std::vector<WORD> style_attributes; // Console attributes of styles, 0 until needed
+            std::unordered_map<WORD, short> attribute_styles; // Style drawn with console attributes
+
+            // Return the nearest console color of a style color
+            static WORD console_color(int color) {
+                if(color >= 0 && color < 16) {
+                    return (WORD)color;
+                }
+                if(color >= 16 && color < 256) {
+                    color = detail::palette_rgb(color);
+                }
+                // Console colors swap the red and blue bits of ANSI colors
+                int ansi = detail::nearest_ansi(color);
+                return (WORD)(((ansi & 1) << 2) | (ansi & 2) | ((ansi & 4) >> 2) | (ansi & 8));
+            }
+
+            // Return the console attributes of a style id
+            // Ids of plain styles are console attributes already
+            WORD console_attributes(short id) {
+                if(id >= 0 && id < StyleTable::plain_styles) {
+                    return (WORD)id;
+                }
+                if(id < 0 || id >= styles.size()) {
+                    return 0x000F;
+                }
+                if((size_t)id >= style_attributes.size()) {
+                    style_attributes.resize(styles.size(), 0);
+                }
+                WORD &attributes = style_attributes[id];
+                if(attributes == 0) {
+                    Style style = styles.get(id);
+                    WORD foreground = console_color(style.foreground);
+                    if(style.attributes & ATTR_BOLD) {
+                        foreground |= FOREGROUND_INTENSITY;
+                    }
+                    attributes = foreground | (console_color(style.background) << 4);
+                    if(style.attributes & ATTR_UNDERLINE) {
+                        attributes |= COMMON_LVB_UNDERSCORE;
+                    }
+                    if(style.attributes & ATTR_REVERSE) {
+                        attributes |= COMMON_LVB_REVERSE_VIDEO;
+                    }
+                    attribute_styles.emplace(attributes, id);
+                }
+                return attributes;
+            }
+
+            // Convert console control key state to modifier flags
+            static int modifier_flags(DWORD state) {
+                return (
+                    ((state & SHIFT_PRESSED) ? MOD_SHIFT : 0) |
+                    ((state & (LEFT_ALT_PRESSED | RIGHT_ALT_PRESSED)) ? MOD_ALT : 0) |
+                    ((state & (LEFT_CTRL_PRESSED | RIGHT_CTRL_PRESSED)) ? MOD_CTRL : 0)
+                );
+            }
+
+            // Read the next queued console input record as an event without waiting
+            bool read_event(Event &event) {
+                event = Event{};
+                DWORD count = 0;
+                while(GetNumberOfConsoleInputEvents(input_handle, &count) && count > 0) {
+                    INPUT_RECORD record;
+                    DWORD read = 0;
+                    if(!ReadConsoleInput(input_handle, &record, 1, &read) || read == 0) {
+                        return false;
+                    }
+                    event.time = std::chrono::steady_clock::now();
+                    if(record.EventType == KEY_EVENT && record.Event.KeyEvent.bKeyDown) {
+                        const KEY_EVENT_RECORD &key = record.Event.KeyEvent;
+                        event.type = KEYDOWN;
+                        event.key = tolower(key.wVirtualKeyCode);
+                        event.modifiers = modifier_flags(key.dwControlKeyState);
+                        return true;
+                    } else if(record.EventType == MOUSE_EVENT) {
+                        const MOUSE_EVENT_RECORD &mouse = record.Event.MouseEvent;
+                        event.x = mouse.dwMousePosition.X;
+                        event.y = mouse.dwMousePosition.Y;
+                        event.modifiers = modifier_flags(mouse.dwControlKeyState);
+                        if(mouse.dwButtonState & FROM_LEFT_1ST_BUTTON_PRESSED) {
+                            event.button = BUTTON_LEFT;
+                            event.key = VK_LBUTTON;
+                        } else if(mouse.dwButtonState & RIGHTMOST_BUTTON_PRESSED) {
+                            event.button = BUTTON_RIGHT;
+                            event.key = VK_RBUTTON;
+                        } else if(mouse.dwButtonState & FROM_LEFT_2ND_BUTTON_PRESSED) {
+                            event.button = BUTTON_MIDDLE;
+                            event.key = VK_MBUTTON;
+                        }
+                        if(mouse.dwEventFlags & MOUSE_WHEELED) {
+                            event.type = MOUSEWHEEL;
+                            event.button = BUTTON_NONE;
+                            event.wheel = ((short)HIWORD(mouse.dwButtonState) > 0) ? -1 : 1;
+                        } else if(mouse.dwEventFlags & MOUSE_MOVED) {
+                            event.type = MOUSEMOTION;
+                        } else if(event.button != BUTTON_NONE) {
+                            event.type = MOUSEBUTTONDOWN;
+                        } else {
+                            event.type = MOUSEBUTTONUP;
+                        }
+                        return true;
+                    } else if(record.EventType == FOCUS_EVENT) {
+                        event.type = record.Event.FocusEvent.bSetFocus ? FOCUSIN : FOCUSOUT;
+                        return true;
+                    } else if(record.EventType == WINDOW_BUFFER_SIZE_EVENT) {
+                        if(columns() != columns_ || rows() != rows_) {
+                            // Reallocate content for the new dimensions
+                            update_dimensions();
+                            delete[] content;
+                            content = new CHAR_INFO[columns_ * rows_];
+                            memset(content, 0, sizeof(CHAR_INFO) * rows_ * columns_);
+                            event.type = WINDOWRESIZE;
+                            return true;
+                        }
+                    }
+                }
+                return false;
+            }
+
+            // Block until console input arrives or wait milliseconds pass, forever if wait is -1
+            // Returns true if woken by wake()
+            bool wait_input(int wait) {
+                HANDLE handles[2] = {input_handle, wake_event};
+                return WaitForMultipleObjects(2, handles, FALSE, wait < 0 ? INFINITE : (DWORD)wait) == WAIT_OBJECT_0 + 1;
+            }
+#elif defined(IS_POSIX)
+            short window_width;
+            short window_height;
+            short columns_;
+            short rows_;
+            int current_pair = 1; // Next free color pair
+            std::unordered_map<int, short> pairs; // Color pair of foreground * 256 + background
+            std::vector<chtype> style_attributes; // Attributes of styles, unresolved until needed
+            std::unordered_map<chtype, short> attribute_styles; // Style drawn with attributes
+            static constexpr chtype unresolved = ~(chtype)0;
+            InputDecoder decoder;
+            std::vector<chtype> line; // Row buffer of blits
+            bool held = false; // A rendered frame waits to be written
+            TimerWheel::Clock::time_point held_since; // Render of the held frame
+
+            TerminalWriter writer; // Writes curses output without blocking
+
+            // Return the number of bytes written to stdout but not read by the terminal yet
+            // Bytes the terminal did not take are counted by the writer, the driver may also
+            // report bytes it holds (ptys on Linux do not)
+            size_t queued_output() const {
+                size_t queued = writer.unwritten();
+#ifdef TIOCOUTQ
+                int driver = 0;
+                if(ioctl(writer.terminal_fd(), TIOCOUTQ, &driver) == 0 && driver > 0) {
+                    queued += (size_t)driver;
+                }
+#endif
+                return queued;
+            }
+
+            // Write the held frame unless the pacer holds it back, return true if written
+            // refresh() only fills the pipe of the writer, so it does not wait for the terminal
+            bool flush() {
+                TimerWheel::Clock::time_point start = TimerWheel::Clock::now();
+                if(!pacer.ready(start, queued_output())) {
+                    return false;
+                }
+                refresh();
+                record_latency(held_since);
+                pacer.written(start, TimerWheel::Clock::now());
+                held = false;
+                return true;
+            }
+            std::chrono::steady_clock::time_point last_input;
+            // Time to wait for the rest of an escape sequence
+            const std::chrono::milliseconds escape_delay{25};
+            int wake_pipe[2];
+
+            // Return the nearest terminal color of a style color
+            // Bright colors are drawn bold on terminals with 8 colors
+            static int curses_color(int color, chtype &attributes, bool foreground) {
+                if(color >= 16 && color < 256 && COLORS < 256) {
+                    color = detail::palette_rgb(color);
+                }
+                if(color >= 256) {
+                    color = COLORS >= 256 ? detail::nearest_palette(color) : detail::nearest_ansi(color);
+                }
+                if(color >= 8 && color < 16 && COLORS < 16) {
+                    if(foreground) {
+                        attributes |= A_BOLD;
+                    }
+                    color -= 8;
+                }
+                return color;
+            }
+
+            // Return the color pair of foreground and background, allocating it if needed
+            // Pair 0 is used once every pair addressable by chtype is taken
+            short color_pair(int foreground, int background) {
+                int key = foreground * 256 + background;
+                auto found = pairs.find(key);
+                if(found != pairs.end()) {
+                    return found->second;
+                }
+                short pair = 0;
+                if(current_pair < std::min(COLOR_PAIRS, 256)) {
+                    pair = (short)current_pair++;
+                    init_pair(pair, foreground, background);
+                }
+                pairs.emplace(key, pair);
+                return pair;
+            }
+
+            // Return the ncurses attributes of a style id
+            // Style 0 is drawn in the default colors of the terminal
+            chtype curses_attributes(short id) {
+                if(id <= 0 || id >= styles.size()) {
+                    return A_NORMAL;
+                }
+                if((size_t)id >= style_attributes.size()) {
+                    style_attributes.resize(styles.size(), unresolved);
+                }
+                chtype &attributes = style_attributes[id];
+                if(attributes == unresolved) {
+                    Style style = styles.get(id);
+                    attributes = A_NORMAL;
+                    attributes |= (style.attributes & ATTR_BOLD) ? A_BOLD : 0;
+                    attributes |= (style.attributes & ATTR_DIM) ? A_DIM : 0;
+                    attributes |= (style.attributes & ATTR_UNDERLINE) ? A_UNDERLINE : 0;
+                    attributes |= (style.attributes & ATTR_REVERSE) ? A_REVERSE : 0;
+#ifdef A_ITALIC
+                    attributes |= (style.attributes & ATTR_ITALIC) ? A_ITALIC : 0;
+#endif
+                    if(has_colors()) {
+                        int foreground = curses_color(style.foreground, attributes, true);
+                        int background = curses_color(style.background, attributes, false);
+                        attributes |= COLOR_PAIR(color_pair(foreground, background));
+                    }
+                    attribute_styles.emplace(attributes, id);
+                }
+                return attributes;
+            }
+
+            // Decode the next event from bytes already read without waiting
+            // Events decoded from the bytes of a read get the time of that read
+            bool read_event(Event &event) {
+                event = Event{};
+                if(decoder.next(event)) {
+                    event.time = last_input;
+                    return true;
+                }
+                if(decoder.pending() && std::chrono::steady_clock::now() - last_input >= escape_delay) {
+                    // No more bytes arrived, decode what is left as keys
+                    bool flushed = decoder.flush(event);
+                    event.time = last_input;
+                    return flushed;
+                }
+                short new_columns = columns();
+                short new_rows = rows();
+                if(new_columns != columns_ || new_rows != rows_) {
+                    update_dimensions();
+                    resizeterm(rows_, columns_);
+                    event.type = WINDOWRESIZE;
+                    event.time = std::chrono::steady_clock::now();
+                    return true;
+                }
+                return false;
+            }
+
+            // Block until stdin is readable or wait milliseconds pass, forever if wait is -1
+            // Bytes read are fed to the decoder, returns true if woken by wake()
+            bool wait_input(int wait) {
+                if(decoder.pending()) {
+                    // Wake up in time to flush an incomplete escape sequence
+                    int delay = (int)std::chrono::duration_cast<std::chrono::milliseconds>(
+                        last_input + escape_delay - std::chrono::steady_clock::now()).count();
+                    delay = std::max(delay, 0);
+                    wait = (wait < 0) ? delay : std::min(wait, delay);
+                }
+                struct pollfd inputs[2] = {{STDIN_FILENO, POLLIN, 0}, {wake_pipe[0], POLLIN, 0}};
+                if(poll(inputs, 2, wait) <= 0) {
+                    return false;
+                }
+                if(inputs[0].revents & POLLIN) {
+                    char bytes[InputDecoder::capacity];
+                    ssize_t count = read(STDIN_FILENO, bytes, decoder.space());
+                    if(count > 0) {
+                        decoder.feed(bytes, count);
+                        last_input = std::chrono::steady_clock::now();
+                    }
+                }
+                if(inputs[1].revents & POLLIN) {
+                    char bytes[64];
+                    while(read(wake_pipe[0], bytes, sizeof(bytes)) > 0) {
+                    }
+                    return true;
+                }
+                return false;
+            }
+#endif
+    };
+
+    // Widget add to window method definitions
+    template<>
+    inline void Window::add(const Paragraph &paragraph) {
+        paint_widget(paragraph);
+    }
+
+    template<>
+    inline void Window::add(const List &list) {
+        paint_widget(list);
+    }
+
+    inline void Window::draw_list_rows(const List &list, int first_row, int last_row) {
+        TimerWheel::Clock::time_point start = begin_raster();
+        DrawContext<Window> context = context_for(list.rect());
+        paint_list_rows(context, list, first_row, last_row);
+        end_raster(start);
+    }
+
+    inline void Window::redraw_list_elements(const List &list, int previous, int current) {
+        if(widget_cache == true) {
+            // Screen shows the list once the rows are drawn
+            fingerprints[list.id] = list.fingerprint();
+        }
+        for(int element : {previous, current}) {
+            int row = element - list.first_element;
+            if(element >= 0 && row >= 0 && row < list.height - 2) {
+                draw_list_rows(list, row, row + 1);
+            }
+        }
+    }
+
+    inline void Window::scroll_list(const List &list, int lines) {
+        int inner_height = list.height - 2;
+        if(lines == 0) {
+            return;
+        }
+        // Vertical borders are the same on every row so they can move with the text,
+        // which lets full width lists use the terminal scroll region
+        int offset = list.border ? 0 : 1;
+        Rect region = {list.x + offset, list.y + 1, list.width - 2 * offset, inner_height};
+        if(
+            abs(lines) >= inner_height || !shows(region, list.id) ||
+            !scroll_rect(region.x, region.y, region.width, region.height, lines)) {
+            // Nothing can be reused, or the list is clipped or covered by other widgets
+            add(list);
+            return;
+        }
+        if(widget_cache == true) {
+            // Screen now shows the scrolled list
+            fingerprints[list.id] = list.fingerprint();
+        }
+        // Only draw rows exposed by the scroll
+        int first_row = lines > 0 ? inner_height - lines : 0;
+        int last_row = lines > 0 ? inner_height : -lines;
+        draw_list_rows(list, first_row, last_row);
+        if(list.border == true) {
+            DrawContext<Window> context = context_for(list.rect());
+            short border_color = context.style(list.border_style);
+            for(int i = list.y + 1 + first_row; i < list.y + 1 + last_row; i++) {
+                context.draw_char(list.x, i, '|', border_color);
+                context.draw_char(list.x + list.width - 1, i, '|', border_color);
+            }
+        }
+    }
+
+    template<>
+    inline void Window::add(const BarChart &bar_chart) {
+        paint_widget_changes(bar_chart);
+    }
+
+    template<>
+    inline void Window::add(const Gauge &gauge) {
+        paint_widget_changes(gauge);
+    }
+
+    template<>
+    inline void Window::add(const Table &table) {
+        paint_widget(table);
+    }
+
+    template<>
+    inline void Window::add(const Heatmap &heatmap) {
+        paint_widget(heatmap);
+    }
+
+    template<>
+    inline void Window::add(const FileView &file_view) {
+        paint_widget(file_view);
+    }
+
+    template<>
+    inline void Window::add(const Tabs &tabs) {
+        paint_widget(tabs);
+    }
+
+    inline void Window::add(PaneStack &panes) {
+        panes.refresh();
+        if(skip_unchanged(panes)) {
+            return;
+        }
+        if(panes.rect().height > 0) {
+            add(panes.tabs);
+        }
+        blit(panes.surface());
+        // Cells of hidden panes now show the pane stack
+        mark_hit(panes.pane_rect(), panes.id);
+        for(const Widget *widget : panes.widgets()) {
+            mark_hit(widget->rect(), widget->id);
+        }
+    }
+
+    // Histograms are drawn as bar charts of their counts
+    template<>
+    inline void Window::add(const Histogram &histogram) {
+        add(static_cast<const BarChart &>(histogram));
+    }
+
+    // Widget set dimensions shortcut
+    void Widget::set_dimensions(int x_, int y_, int width_, int height_) {
+        x = x_;
+        y = y_;
+        width = width_;
+        height = height_;
+    }
+
+    inline Rect Widget::rect() const {
+        return {x, y, width, height};
+    }
+
+    // Widget setters
+    // Content members are only covered by fingerprints through generation
+    inline void Widget::set_title(const std::string &title_) {
+        title = title_;
+        touch();
+    }
+
+    inline void Widget::touch() {
+        generation++;
+    }
+
+    inline void Paragraph::set_text(const std::string &text_) {
+        text = text_;
+        spans.clear();
+        touch();
+    }
+
+    namespace detail {
+        // Apply the color and attribute names of a markup tag such as "bold red on blue" to style
+        // Return false if tag has any other word
+        inline bool apply_style_tag(const std::string &tag, Style &style) {
+            static const std::pair<const char *, int> colors[] = {
+                {"black", BLACK}, {"red", RED}, {"green", GREEN}, {"yellow", YELLOW},
+                {"blue", BLUE}, {"magenta", MAGENTA}, {"cyan", CYAN}, {"white", WHITE}
+            };
+            static const std::pair<const char *, int> attributes[] = {
+                {"bold", ATTR_BOLD}, {"dim", ATTR_DIM}, {"italic", ATTR_ITALIC},
+                {"underline", ATTR_UNDERLINE}, {"reverse", ATTR_REVERSE}
+            };
+            Style result = style;
+            bool background = false;
+            bool empty = true;
+            size_t start = 0;
+            while(start < tag.length()) {
+                size_t end = tag.find(' ', start);
+                if(end == std::string::npos) {
+                    end = tag.length();
+                }
+                std::string word = tag.substr(start, end - start);
+                start = end + 1;
+                if(word.empty()) {
+                    continue;
+                }
+                empty = false;
+                if(word == "on" && !background) {
+                    background = true;
+                    continue;
+                }
+                bool known = false;
+                for(const auto &color : colors) {
+                    if(word == color.first) {
+                        (background ? result.background : result.foreground) = color.second;
+                        known = true;
+                    }
+                }
+                for(const auto &attribute : attributes) {
+                    if(word == attribute.first && !background) {
+                        result.attributes |= attribute.second;
+                        known = true;
+                    }
+                }
+                if(!known) {
+                    return false;
+                }
+            }
+            if(empty) {
+                return false;
+            }
+            style = result;
+            return true;
+        }
+    }
+
+    inline void Paragraph::set_markup(const std::string &markup) {
+        text.clear();
+        spans.clear();
+        // Styles of open tags, text outside tags is drawn in text_style
+        std::vector<Style> open;
+        size_t run_start = 0;
+        auto end_run = [&]() {
+            if(!open.empty() && text.length() > run_start) {
+                // Runs of the same style are merged, e.g. across nested tags
+                if(!spans.empty() && spans.back().offset + spans.back().length == run_start && spans.back().style == open.back()) {
+                    spans.back().length += text.length() - run_start;
+                } else {
+                    spans.push_back({(uint32_t)run_start, (uint32_t)(text.length() - run_start), open.back()});
+                }
+            }
+            run_start = text.length();
+        };
+        size_t i = 0;
+        while(i < markup.length()) {
+            size_t bracket = markup.find('[', i);
+            if(bracket == std::string::npos) {
+                text.append(markup, i, std::string::npos);
+                break;
+            }
+            text.append(markup, i, bracket - i);
+            i = bracket + 1;
+            if(i < markup.length() && markup[i] == '[') {
+                // Escaped bracket
+                text += '[';
+                i++;
+                continue;
+            }
+            size_t close = markup.find(']', i);
+            std::string tag = close == std::string::npos ? std::string() : markup.substr(i, close - i);
+            Style style = open.empty() ? text_style : open.back();
+            if(tag == "/" && !open.empty()) {
+                end_run();
+                open.pop_back();
+            } else if(close != std::string::npos && detail::apply_style_tag(tag, style)) {
+                end_run();
+                open.push_back(style);
+            } else {
+                // Not a tag
+                text += '[';
+                continue;
+            }
+            i = close + 1;
+        }
+        end_run();
+        touch();
+    }
+
+    inline void Paragraph::append(const std::string &text_) {
+        text += text_;
+        touch();
+    }
+
+    inline void Paragraph::append(const std::string &text_, const Style &style) {
+        uint32_t offset = text.length();
+        text += text_;
+        if(!text_.empty()) {
+            if(!spans.empty() && spans.back().offset + spans.back().length == offset && spans.back().style == style) {
+                spans.back().length += text_.length();
+            } else {
+                spans.push_back({offset, (uint32_t)text_.length(), style});
+            }
+        }
+        touch();
+    }
+
+    inline void List::set_rows(const std::vector<std::string> &rows_) {
+        rows = rows_;
+        touch();
+    }
+
+    inline size_t List::visible_size() const {
+        return view ? view->size() : rows.size();
+    }
+
+    inline void BarChart::set_data(const std::vector<int> &data_) {
+        data = data_;
+        touch();
+    }
+
+    inline void BarChart::set_labels(const std::vector<std::string> &labels_) {
+        labels = labels_;
+        touch();
+    }
+
+    inline void Gauge::set_percent(int percent_) {
+        percent = percent_;
+        touch();
+    }
+
+    inline void Gauge::set_label(const std::string &label_) {
+        label = label_;
+        touch();
+    }
+
+    inline void Heatmap::set_values(const float *values_, int rows, int columns) {
+        values = values_;
+        matrix_rows = rows;
+        matrix_columns = columns;
+        touch();
+    }
+
+    inline void Heatmap::set_range(float minimum_, float maximum_) {
+        minimum = minimum_;
+        maximum = maximum_;
+        touch();
+    }
+
+    // Widget fingerprints
+    inline uint64_t Widget::fingerprint() const {
+        const int64_t values[] = {
+            (int64_t)generation, x, y, width, height, border,
+            border_style.foreground, border_style.background, border_style.attributes,
+            text_style.foreground, text_style.background, text_style.attributes,
+            title_style.foreground, title_style.background, title_style.attributes
+        };
+        uint64_t hash = id;
+        for(int64_t value : values) {
+            hash = detail::hash_combine(hash, value);
+        }
+        return hash;
+    }
+
+    inline uint64_t Paragraph::fingerprint() const {
+        return Widget::fingerprint();
+    }
+
+    inline uint64_t List::fingerprint() const {
+        const int64_t values[] = {
+            first_element, (int64_t)(uintptr_t)view.get(),
+            (int64_t)std::hash<std::string>()(highlight),
+            highlight_style.foreground, highlight_style.background, highlight_style.attributes,
+            selected, selected_style.foreground, selected_style.background, selected_style.attributes,
+            hovered, hover_style.foreground, hover_style.background, hover_style.attributes
+        };
+        uint64_t hash = Widget::fingerprint();
+        for(int64_t value : values) {
+            hash = detail::hash_combine(hash, value);
+        }
+        return hash;
+    }
+
+    inline uint64_t BarChart::fingerprint() const {
+        const int64_t values[] = {
+            bar_width, bar_color,
+            label_style.foreground, label_style.background, label_style.attributes,
+            number_style.foreground, number_style.background, number_style.attributes
+        };
+        uint64_t hash = Widget::fingerprint();
+        for(int64_t value : values) {
+            hash = detail::hash_combine(hash, value);
+        }
+        return hash;
+    }
+
+    inline uint64_t Gauge::fingerprint() const {
+        const int64_t values[] = {
+            percent, bar_color,
+            label_style.foreground, label_style.background, label_style.attributes
+        };
+        uint64_t hash = Widget::fingerprint();
+        for(int64_t value : values) {
+            hash = detail::hash_combine(hash, value);
+        }
+        return hash;
+    }
+
+    inline uint64_t Table::fingerprint() const {
+        const int64_t values[] = {
+            first_element,
+            header_style.foreground, header_style.background, header_style.attributes
+        };
+        uint64_t hash = Widget::fingerprint();
+        for(int64_t value : values) {
+            hash = detail::hash_combine(hash, value);
+        }
+        return hash;
+    }
+
+    inline uint64_t Heatmap::fingerprint() const {
+        const int64_t values_[] = {
+            (int64_t)(uintptr_t)values, matrix_rows, matrix_columns,
+            pooling, half_blocks, (int64_t)ramp.size(), (int64_t)colors.size()
+        };
+        uint64_t hash = Widget::fingerprint();
+        for(int64_t value : values_) {
+            hash = detail::hash_combine(hash, value);
+        }
+        uint32_t range[2];
+        memcpy(&range[0], &minimum, sizeof(float));
+        memcpy(&range[1], &maximum, sizeof(float));
+        return detail::hash_combine(detail::hash_combine(hash, range[0]), range[1]);
+    }
+
+    inline int Tabs::tab_at(int x_) const {
+        int left = x + (border ? 1 : 0);
+        for(size_t i = 0; i < titles.size(); i++) {
+            int right = left + (int)titles[i].length() + 2;
+            if(x_ >= left && x_ < right) {
+                return (int)i;
+            }
+            left = right + 1;
+        }
+        return -1;
+    }
+
+    inline uint64_t Tabs::fingerprint() const {
+        uint64_t hash = detail::hash_combine(Widget::fingerprint(), active);
+        hash = detail::hash_combine(hash, active_style.foreground);
+        hash = detail::hash_combine(hash, active_style.background);
+        return detail::hash_combine(hash, active_style.attributes);
+    }
+
+    inline uint64_t FileView::fingerprint() const {
+        const int64_t values[] = {(int64_t)first_line, first_column, tab_width, (int64_t)(uintptr_t)file.get()};
+        uint64_t hash = Widget::fingerprint();
+        for(int64_t value : values) {
+            hash = detail::hash_combine(hash, value);
+        }
+        return hash;
+    }
+
+    // Scroll up the list
+    // Window is a tui::Window or a stand-in with scroll_list()
+    template<typename Window>
+    void List::scroll_up(Window &window, int factor) {
+        if(visible_size() > height - 2) {
+            int previous = first_element;
+            first_element = std::max(0, (int)(first_element - factor));
+            window.scroll_list(*this, first_element - previous);
+        }
+    }
+
+    // Scroll down the list
+    template<typename Window>
+    void List::scroll_down(Window &window, int factor) {
+        if(visible_size() > height - 2) {
+            int previous = first_element;
+            first_element = std::min((int)(visible_size() - (height - 2)), (first_element + factor));
+            window.scroll_list(*this, first_element - previous);
+        }
+    }
+
+    // Dispatch a mouse event to the list if the hit map shows it under the pointer
+    // Window is a tui::Window or a stand-in with widget_at(), scroll_list() and redraw_list_elements()
+    template<typename Window>
+    bool List::handle_event(Window &window, const Event &event) {
+        if(event.type != MOUSEBUTTONDOWN && event.type != MOUSEWHEEL && event.type != MOUSEMOTION) {
+            return false;
+        }
+        // Copies share the id, so the cell must also lie inside this copy
+        bool inside = rect().contains(event.x, event.y) && window.widget_at(event.x, event.y) == id;
+        int row = event.y - (y + 1);
+        // Return the row under the pointer, -1 over borders or below the last row
+        auto element_at = [&]() {
+            bool on_row = inside && row >= 0 && row < height - 2 && event.x > x && event.x < x + width - 1;
+            return on_row && first_element + row < (int)visible_size() ? first_element + row : -1;
+        };
+        if(event.type == MOUSEBUTTONDOWN) {
+            int element = element_at();
+            if(element < 0 || event.button != BUTTON_LEFT) {
+                return inside;
+            }
+            int previous = selected;
+            selected = element;
+            window.redraw_list_elements(*this, previous, selected);
+        } else if(event.type == MOUSEWHEEL) {
+            if(!inside) {
+                return false;
+            }
+            if(event.wheel > 0) {
+                scroll_down(window, event.wheel);
+            } else {
+                scroll_up(window, -event.wheel);
+            }
+        }
+        // Rows move under the pointer when scrolling
+        int element = element_at();
+        if(element != hovered) {
+            int previous = hovered;
+            hovered = element;
+            window.redraw_list_elements(*this, previous, hovered);
+        }
+        return inside;
+    }
+
+    // Table columns
+    inline size_t TableColumn::size() const {
+        switch(type) {
+            case INTEGER:
+                return integers.size();
+            case REAL:
+                return reals.size();
+            default:
+                return texts.size();
+        }
+    }
+
+    template<typename T>
+    inline void TableColumn::push(const T &value) {
+        if constexpr(std::is_arithmetic<T>::value) {
+            if(type == INTEGER) {
+                integers.push_back((int64_t)value);
+            } else if(type == REAL) {
+                reals.push_back((double)value);
+            } else {
+                push(std::to_string(value));
+                return;
+            }
+        } else {
+            if(type != TEXT) {
+                throw TUIException("Text added to numeric column: " + name);
+            }
+            std::string text(value);
+            auto found = interned.find(text);
+            if(found == interned.end()) {
+                found = interned.emplace(text, (uint32_t)strings.size()).first;
+                strings.push_back(text);
+            }
+            texts.push_back(found->second);
+        }
+        // Widths grow with the data so layout never scans the rows
+        char buffer[32];
+        int length;
+        format(size() - 1, buffer, length);
+        width = std::max(width, length);
+    }
+
+    inline void TableColumn::push_empty() {
+        if(type == TEXT) {
+            push("");
+        } else if(type == REAL) {
+            push(NAN);
+        } else {
+            push(0);
+        }
+    }
+
+    inline const char *TableColumn::format(size_t row, char (&buffer)[32], int &length) const {
+        switch(type) {
+            case INTEGER:
+                length = snprintf(buffer, sizeof(buffer), "%lld", (long long)integers[row]);
+                break;
+            case REAL:
+                if(std::isnan(reals[row])) {
+                    // Missing values are shown empty
+                    buffer[0] = '\0';
+                    length = 0;
+                } else {
+                    length = snprintf(buffer, sizeof(buffer), "%.*f", precision, reals[row]);
+                }
+                break;
+            default: {
+                const std::string &text = strings[texts[row]];
+                length = text.length();
+                return text.c_str();
+            }
+        }
+        length = std::min(length, (int)sizeof(buffer) - 1);
+        return buffer;
+    }
+
+    namespace detail {
+        // Thread running the sorts and filters of every table one after another
+        // Started by the first query and kept for later ones, so re-sorting does not
+        // start a thread per query. Jobs of cancelled queries return at once.
+        class QueryWorker {
+            public:
+                static QueryWorker &instance() {
+                    static QueryWorker worker;
+                    return worker;
+                }
+
+                // Run job on the worker after the jobs queued before it
+                void submit(std::function<void()> job) {
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if(!thread.joinable()) {
+                            thread = std::thread(&QueryWorker::run, this);
+                        }
+                        jobs.push_back(std::move(job));
+                    }
+                    wake.notify_one();
+                }
+
+                ~QueryWorker() {
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        stopping = true;
+                    }
+                    wake.notify_one();
+                    if(thread.joinable()) {
+                        thread.join();
+                    }
+                }
+
+            private:
+                std::mutex mutex;
+                std::condition_variable wake;
+                std::deque<std::function<void()> > jobs;
+                bool stopping = false; // Queued jobs are dropped at exit
+                std::thread thread;
+
+                void run() {
+                    while(true) {
+                        std::function<void()> job;
+                        {
+                            std::unique_lock<std::mutex> lock(mutex);
+                            wake.wait(lock, [this]() {
+                                return stopping || !jobs.empty();
+                            });
+                            if(stopping) {
+                                return;
+                            }
+                            job = std::move(jobs.front());
+                            jobs.pop_front();
+                        }
+                        job();
+                    }
+                }
+        };
+
+        // Filter and sort rows of data, or every row if base is null
+        // Runs on the query worker and stops early when the query is cancelled
+        inline void run_table_query(const TableData &data, const std::vector<uint32_t> *base,
+                int filter_column, const std::string &filter_text, int sort_column, bool ascending, TableQuery &query) {
+            if(query.cancelled) {
+                return;
+            }
+            std::vector<uint32_t> rows;
+            if(base != nullptr) {
+                rows = *base;
+            } else {
+                rows.resize(data.rows);
+                for(size_t i = 0; i < rows.size(); i++) {
+                    rows[i] = (uint32_t)i;
+                }
+            }
+            if(filter_column >= 0) {
+                const TableColumn &column = data.columns[filter_column];
+                // Interned strings are matched once, not once per row
+                std::vector<char> matches;
+                if(column.type == TableColumn::TEXT) {
+                    matches.resize(column.strings.size());
+                    for(size_t i = 0; i < matches.size(); i++) {
+                        matches[i] = column.strings[i].find(filter_text) != std::string::npos;
+                    }
+                }
+                size_t kept = 0;
+                char buffer[32];
+                int length;
+                for(size_t i = 0; i < rows.size(); i++) {
+                    if((i & 0xFFFF) == 0 && query.cancelled) {
+                        return;
+                    }
+                    uint32_t row = rows[i];
+                    bool match = false;
+                    if(row < column.size()) {
+                        if(column.type == TableColumn::TEXT) {
+                            match = matches[column.texts[row]];
+                        } else {
+                            const char *text = column.format(row, buffer, length);
+                            match = strstr(text, filter_text.c_str()) != nullptr;
+                        }
+                    }
+                    if(match) {
+                        rows[kept++] = row;
+                    }
+                }
+                rows.resize(kept);
+            }
+            if(sort_column >= 0 && !query.cancelled) {
+                const TableColumn &column = data.columns[sort_column];
+                // Sort keys next to their rows, rows without a value go last
+                auto sort_rows = [&](auto key, auto valid) {
+                    typedef decltype(key(0)) Key;
+                    std::vector<std::pair<Key, uint32_t> > keyed;
+                    std::vector<uint32_t> missing;
+                    keyed.reserve(rows.size());
+                    for(size_t i = 0; i < rows.size(); i++) {
+                        if((i & 0xFFFF) == 0 && query.cancelled) {
+                            return;
+                        }
+                        uint32_t row = rows[i];
+                        if(row < column.size() && valid(row)) {
+                            keyed.push_back(std::make_pair(key(row), row));
+                        } else {
+                            missing.push_back(row);
+                        }
+                    }
+                    if(query.cancelled) {
+                        return;
+                    }
+                    std::stable_sort(keyed.begin(), keyed.end(), [&](const std::pair<Key, uint32_t> &a, const std::pair<Key, uint32_t> &b) {
+                        return ascending ? a.first < b.first : b.first < a.first;
+                    });
+                    if(query.cancelled) {
+                        return;
+                    }
+                    for(size_t i = 0; i < keyed.size(); i++) {
+                        rows[i] = keyed[i].second;
+                    }
+                    std::copy(missing.begin(), missing.end(), rows.begin() + keyed.size());
+                };
+                auto always = [](uint32_t) {
+                    return true;
+                };
+                if(column.type == TableColumn::INTEGER) {
+                    sort_rows([&](uint32_t row) { return column.integers[row]; }, always);
+                } else if(column.type == TableColumn::REAL) {
+                    sort_rows([&](uint32_t row) { return column.reals[row]; }, [&](uint32_t row) {
+                        return !std::isnan(column.reals[row]);
+                    });
+                } else {
+                    // Rank the distinct strings once and sort rows by rank
+                    std::vector<uint32_t> order(column.strings.size());
+                    for(size_t i = 0; i < order.size(); i++) {
+                        order[i] = (uint32_t)i;
+                    }
+                    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+                        return column.strings[a] < column.strings[b];
+                    });
+                    if(query.cancelled) {
+                        return;
+                    }
+                    std::vector<uint32_t> rank(order.size());
+                    for(size_t i = 0; i < order.size(); i++) {
+                        rank[order[i]] = (uint32_t)i;
+                    }
+                    sort_rows([&](uint32_t row) { return rank[column.texts[row]]; }, always);
+                }
+            }
+            // A sort cancelled part way leaves rows unfinished
+            if(query.cancelled) {
+                return;
+            }
+            query.rows.swap(rows);
+            query.done = true;
+        }
+    }
+
+    // Table
+    inline int Table::add_column(const std::string &name, TableColumn::Type type, int precision) {
+        TableData &columns = edit();
+        columns.columns.emplace_back();
+        TableColumn &column = columns.columns.back();
+        column.name = name;
+        column.type = type;
+        column.precision = precision;
+        column.width = name.length();
+        for(size_t i = 0; i < columns.rows; i++) {
+            column.push_empty();
+        }
+        touch();
+        return (int)columns.columns.size() - 1;
+    }
+
+    template<typename ... Values>
+    inline void Table::add_row(const Values &... values) {
+        TableData &columns = edit();
+        if(sizeof...(Values) > columns.columns.size()) {
+            throw TUIException("Row has more values than the table has columns");
+        }
+        // Check every value before pushing any, so a bad row leaves the columns aligned
+        size_t index = 0;
+        auto check = [&](const auto &value) {
+            const TableColumn &column = columns.columns[index++];
+            if(!std::is_arithmetic<std::decay_t<decltype(value)> >::value && column.type != TableColumn::TEXT) {
+                throw TUIException("Text added to numeric column: " + column.name);
+            }
+        };
+        (check(values), ...);
+        index = 0;
+        auto push = [&](const auto &value) {
+            TableColumn &column = columns.columns[index++];
+            column.push(value);
+        };
+        (push(values), ...);
+        // Keep columns aligned
+        for(; index < columns.columns.size(); index++) {
+            columns.columns[index].push_empty();
+        }
+        columns.rows++;
+        stale = sort_column >= 0 || filter_column >= 0;
+        touch();
+    }
+
+    inline void Table::clear_rows() {
+        TableData &columns = edit();
+        for(TableColumn &column : columns.columns) {
+            column.integers.clear();
+            column.reals.clear();
+            column.texts.clear();
+            column.strings.clear();
+            column.interned.clear();
+            column.width = column.name.length();
+        }
+        columns.rows = 0;
+        first_element = 0;
+        start_query(nullptr, false, false);
+        stale = sort_column >= 0 || filter_column >= 0;
+        touch();
+    }
+
+    inline size_t Table::size() const {
+        return data->rows;
+    }
+
+    inline size_t Table::visible_size() const {
+        return view ? view->size() : data->rows;
+    }
+
+    inline void Table::sort_by(int column, bool ascending_) {
+        sort_column = column;
+        ascending = ascending_;
+        if(column >= 0 && view && !stale && !query) {
+            // The view already holds the filtered rows
+            start_query(view, false, column >= 0);
+        } else {
+            start_query(nullptr, true, column >= 0);
+        }
+    }
+
+    inline void Table::filter_by(int column, const std::string &text) {
+        bool refine = (
+            view && !stale && !query && column >= 0 && column == filter_column &&
+            !filter_text.empty() && text.compare(0, filter_text.length(), filter_text) == 0
+        );
+        filter_column = text.empty() ? -1 : column;
+        filter_text = text;
+        if(refine) {
+            // Rows not matching the shorter text cannot match the longer one
+            start_query(view, true, false);
+        } else {
+            start_query(nullptr, true, sort_column >= 0);
+        }
+    }
+
+    inline bool Table::busy() const {
+        return query && !query->done;
+    }
+
+    inline bool Table::poll() {
+        bool changed = false;
+        if(query && query->done) {
+            view = std::make_shared<const std::vector<uint32_t> >(std::move(query->rows));
+            query.reset();
+            changed = true;
+        }
+        if(stale && !query) {
+            start_query(nullptr, true, sort_column >= 0);
+        }
+        if(changed) {
+            scroll_up(0);
+            touch();
+        }
+        return changed;
+    }
+
+    inline void Table::scroll_up(int factor) {
+        int last = std::max(0, (int)visible_size() - (height - 3));
+        first_element = std::max(0, std::min(last, first_element - factor));
+    }
+
+    inline void Table::scroll_down(int factor) {
+        scroll_up(-factor);
+    }
+
+    inline TableData &Table::edit() {
+        // use_count alone does not order the worker's reads before our writes, readers does
+        if(data->readers.load(std::memory_order_acquire) > 0 || data.use_count() > 1) {
+            data = std::make_shared<TableData>(*data);
+        }
+        return *data;
+    }
+
+    // Start computing the view from base, or every row if base is null
+    inline void Table::start_query(std::shared_ptr<const std::vector<uint32_t> > base, bool filter, bool sort) {
+        if(query) {
+            query->cancelled = true;
+            query.reset();
+        }
+        stale = false;
+        if(filter_column >= (int)data->columns.size() || sort_column >= (int)data->columns.size()) {
+            throw TUIException("Table column does not exist");
+        }
+        filter = filter && filter_column >= 0;
+        if(!filter && !sort && !base) {
+            // Data order is shown without a worker
+            if(view) {
+                view.reset();
+                scroll_up(0);
+                touch();
+            }
+            return;
+        }
+        std::shared_ptr<detail::TableQuery> next = std::make_shared<detail::TableQuery>();
+        std::shared_ptr<const TableData> snapshot = data;
+        int filter_column_ = filter ? filter_column : -1;
+        int sort_column_ = sort ? sort_column : -1;
+        std::string filter_text_ = filter_text;
+        bool ascending_ = ascending;
+        snapshot->readers.fetch_add(1, std::memory_order_relaxed);
+        detail::QueryWorker::instance().submit([next, snapshot, base, filter_column_, filter_text_, sort_column_, ascending_]() {
+            detail::run_table_query(*snapshot, base.get(), filter_column_, filter_text_, sort_column_, ascending_, *next);
+            snapshot->readers.fetch_sub(1, std::memory_order_release);
+        });
+        query = next;
+    }
+
+    // Histogram
+    namespace detail {
+        // Return a bin count as a bar value, counts beyond the range of int draw as INT_MAX
+        inline int bar_value(double count) {
+            if(!(count >= 0)) {
+                return 0;
+            }
+            return count >= INT_MAX ? INT_MAX : (int)llround(count);
+        }
+
+        // Format value in at most a few characters, for labels
+        inline std::string short_number(double value) {
+            const char *suffixes[] = {"", "k", "M", "G", "T"};
+            int suffix = 0;
+            while(fabs(value) >= 1000 && suffix < 4) {
+                value /= 1000;
+                suffix++;
+            }
+            char buffer[32];
+            snprintf(buffer, sizeof(buffer), "%.3g%s", value, suffixes[suffix]);
+            return buffer;
+        }
+
+        // Return the HDR bin of value, keeping its top sub_bucket_bits + 1 bits
+        inline uint64_t hdr_bin(uint64_t value, int sub_bucket_bits) {
+            uint64_t sub_buckets = (uint64_t)1 << sub_bucket_bits;
+            if(value < 2 * sub_buckets) {
+                return value;
+            }
+#if defined(__GNUC__) || defined(__clang__)
+            int exponent = 63 - __builtin_clzll(value);
+#else
+            int exponent = 63;
+            while(!(value >> exponent)) {
+                exponent--;
+            }
+#endif
+            int shift = exponent - sub_bucket_bits;
+            return (uint64_t)(shift + 1) * sub_buckets + ((value >> shift) - sub_buckets);
+        }
+    }
+
+    inline void Histogram::set_linear_bins(double minimum_, double maximum_, int bins) {
+        scale = LINEAR_BINS;
+        minimum = minimum_;
+        maximum = maximum_;
+        reset_bins(bins);
+    }
+
+    inline void Histogram::set_log_bins(double minimum_, double maximum_, int bins) {
+        if(minimum_ <= 0) {
+            throw TUIException("Logarithmic bins must start above 0");
+        }
+        scale = LOG_BINS;
+        minimum = minimum_;
+        maximum = maximum_;
+        reset_bins(bins);
+    }
+
+    inline void Histogram::set_hdr_bins(double unit, double maximum_, int sub_bucket_bits_) {
+        if(unit <= 0 || sub_bucket_bits_ < 0 || sub_bucket_bits_ > 16) {
+            throw TUIException("HDR bins need a positive unit and at most 16 sub bucket bits");
+        }
+        scale = HDR_BINS;
+        minimum = unit;
+        maximum = maximum_;
+        sub_bucket_bits = sub_bucket_bits_;
+        reset_bins((int)detail::hdr_bin((uint64_t)(maximum / unit), sub_bucket_bits) + 1);
+    }
+
+    // Size the bins, clear counts and label every bin with its lower edge
+    inline void Histogram::reset_bins(int bins) {
+        if(bins <= 0 || maximum <= minimum) {
+            throw TUIException("Histogram needs at least one bin and maximum above minimum");
+        }
+        counts.assign(bins, 0);
+        partial.assign(4 * bins, 0);
+        data.assign(bins, 0);
+        labels.resize(bins);
+        for(int i = 0; i < bins; i++) {
+            labels[i] = detail::short_number(lower_edge(i));
+        }
+        total = 0;
+        touch();
+    }
+
+    inline int Histogram::bin_of(double sample) const {
+        int last = (int)counts.size() - 1;
+        double position;
+        if(scale == HDR_BINS) {
+            double units = sample / minimum;
+            if(!(units >= 0)) {
+                return 0;
+            }
+            if(units >= 9.0e18) {
+                return last;
+            }
+            return (int)std::min<uint64_t>(detail::hdr_bin((uint64_t)units, sub_bucket_bits), last);
+        } else if(scale == LOG_BINS) {
+            position = log2(sample / minimum) / log2(maximum / minimum) * counts.size();
+        } else {
+            position = (sample - minimum) / (maximum - minimum) * counts.size();
+        }
+        position = position >= 0 ? position : 0;
+        position = position <= last ? position : last;
+        return (int)position;
+    }
+
+    inline void Histogram::push(double sample) {
+        if(counts.empty()) {
+            throw TUIException("Histogram has no bins");
+        }
+        int bin = bin_of(sample);
+        counts[bin] += 1;
+        total += 1;
+        data[bin] = detail::bar_value(counts[bin]);
+        touch();
+    }
+
+    inline void Histogram::push(const double *samples, size_t count) {
+        if(counts.empty()) {
+            throw TUIException("Histogram has no bins");
+        }
+        size_t bins = counts.size();
+        double last = (double)(bins - 1);
+        double offset = minimum;
+        double factor = bins / (maximum - minimum);
+        if(scale == LOG_BINS) {
+            offset = log2(minimum);
+            factor = bins / log2(maximum / minimum);
+        }
+        // Bins are computed in chunks by a loop without branches which compilers vectorize,
+        // counting alternates between four sets so consecutive equal bins do not stall
+        const size_t chunk = 1024;
+        int32_t indices[chunk];
+        uint32_t *sets = partial.data();
+        for(size_t start = 0; start < count; start += chunk) {
+            size_t size = std::min(chunk, count - start);
+            const double *values = samples + start;
+            if(scale == HDR_BINS) {
+                double inverse = 1 / minimum;
+                for(size_t i = 0; i < size; i++) {
+                    double units = values[i] * inverse;
+                    units = units >= 0 ? units : 0;
+                    units = units <= 9.0e18 ? units : 9.0e18;
+                    indices[i] = (int32_t)std::min<uint64_t>(detail::hdr_bin((uint64_t)units, sub_bucket_bits), bins - 1);
+                }
+            } else if(scale == LOG_BINS) {
+                for(size_t i = 0; i < size; i++) {
+                    double position = (log2(values[i]) - offset) * factor;
+                    position = position >= 0 ? position : 0;
+                    position = position <= last ? position : last;
+                    indices[i] = (int32_t)position;
+                }
+            } else {
+                for(size_t i = 0; i < size; i++) {
+                    double position = (values[i] - offset) * factor;
+                    position = position >= 0 ? position : 0;
+                    position = position <= last ? position : last;
+                    indices[i] = (int32_t)position;
+                }
+            }
+            size_t i = 0;
+            for(; i + 4 <= size; i += 4) {
+                sets[indices[i]]++;
+                sets[bins + indices[i + 1]]++;
+                sets[2 * bins + indices[i + 2]]++;
+                sets[3 * bins + indices[i + 3]]++;
+            }
+            for(; i < size; i++) {
+                sets[indices[i]]++;
+            }
+        }
+        for(size_t bin = 0; bin < bins; bin++) {
+            uint32_t added = sets[bin] + sets[bins + bin] + sets[2 * bins + bin] + sets[3 * bins + bin];
+            sets[bin] = sets[bins + bin] = sets[2 * bins + bin] = sets[3 * bins + bin] = 0;
+            counts[bin] += added;
+            data[bin] = detail::bar_value(counts[bin]);
+        }
+        total += count;
+        touch();
+    }
+
+    inline void Histogram::decay(double factor) {
+        for(size_t bin = 0; bin < counts.size(); bin++) {
+            counts[bin] *= factor;
+            data[bin] = detail::bar_value(counts[bin]);
+        }
+        total *= factor;
+        touch();
+    }
+
+    inline void Histogram::clear() {
+        std::fill(counts.begin(), counts.end(), 0);
+        std::fill(data.begin(), data.end(), 0);
+        total = 0;
+        touch();
+    }
+
+    inline double Histogram::lower_edge(int bin) const {
+        if(scale == HDR_BINS) {
+            uint64_t sub_buckets = (uint64_t)1 << sub_bucket_bits;
+            if((uint64_t)bin < 2 * sub_buckets) {
+                return bin * minimum;
+            }
+            int shift = bin / sub_buckets - 1;
+            return (double)((bin % sub_buckets + sub_buckets) << shift) * minimum;
+        } else if(scale == LOG_BINS) {
+            return minimum * pow(maximum / minimum, (double)bin / counts.size());
+        }
+        return minimum + (maximum - minimum) * bin / counts.size();
+    }
+
+    inline double Histogram::percentile(double percent) const {
+        double target = total * percent / 100;
+        double below = 0;
+        for(size_t bin = 0; bin < counts.size(); bin++) {
+            if(counts[bin] > 0 && below + counts[bin] >= target) {
+                // Interpolate inside the bin
+                double lower = lower_edge(bin);
+                double upper = bin + 1 < counts.size() ? lower_edge(bin + 1) : std::max(maximum, lower);
+                return lower + (upper - lower) * (target - below) / counts[bin];
+            }
+            below += counts[bin];
+        }
+        return counts.empty() ? 0 : lower_edge(0);
+    }
+
+    // File view
+    namespace detail {
+        inline FileMapping::~FileMapping() {
+#ifdef IS_WIN
+            if(data != nullptr) {
+                UnmapViewOfFile(data);
+            }
+            if(mapping != NULL) {
+                CloseHandle(mapping);
+            }
+#elif defined(IS_POSIX)
+            if(data != nullptr) {
+                munmap((void *)data, (size_t)size);
+            }
+#endif
+        }
+
+        inline FileIndex::~FileIndex() {
+#ifdef IS_WIN
+            if(handle != INVALID_HANDLE_VALUE) {
+                CloseHandle(handle);
+            }
+#elif defined(IS_POSIX)
+            if(fd >= 0) {
+                ::close(fd);
+            }
+#endif
+        }
+
+        // Set size to the size of the open file, returns false if it cannot be read
+        inline bool file_size(const FileIndex &file, uint64_t &size) {
+#ifdef IS_WIN
+            LARGE_INTEGER result;
+            if(!GetFileSizeEx(file.handle, &result)) {
+                return false;
+            }
+            size = (uint64_t)result.QuadPart;
+#elif defined(IS_POSIX)
+            struct stat info;
+            if(fstat(file.fd, &info) != 0) {
+                return false;
+            }
+            size = (uint64_t)info.st_size;
+#endif
+            return true;
+        }
+
+        // Map the first size bytes of the file, only address space is reserved
+        inline std::shared_ptr<const FileMapping> map_file(const FileIndex &file, uint64_t size) {
+            std::shared_ptr<FileMapping> mapping = std::make_shared<FileMapping>();
+            if(size == 0) {
+                return mapping;
+            }
+#ifdef IS_WIN
+            mapping->mapping = CreateFileMapping(file.handle, NULL, PAGE_READONLY, (DWORD)(size >> 32), (DWORD)size, NULL);
+            if(mapping->mapping != NULL) {
+                mapping->data = (const char *)MapViewOfFile(mapping->mapping, FILE_MAP_READ, 0, 0, (SIZE_T)size);
+            }
+            if(mapping->data == nullptr) {
+                throw TUIException("Cannot map file");
+            }
+#elif defined(IS_POSIX)
+            void *data = mmap(nullptr, (size_t)size, PROT_READ, MAP_SHARED, file.fd, 0);
+            if(data == MAP_FAILED) {
+                throw TUIException(std::string("Cannot map file: ") + strerror(errno));
+            }
+            mapping->data = (const char *)data;
+#endif
+            mapping->size = size;
+            return mapping;
+        }
+
+        // Drop pages from the resident memory of the process, they are read again if drawn
+        inline void release_pages(const FileMapping &mapping, uint64_t start, uint64_t end) {
+#ifdef IS_WIN
+            // Unlocking pages which are not locked removes them from the working set
+            VirtualUnlock((LPVOID)(mapping.data + start), (SIZE_T)(end - start));
+#elif defined(IS_POSIX)
+            static const uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+            uint64_t first = start / page * page;
+            madvise((void *)(mapping.data + first), (size_t)(end - first), MADV_DONTNEED);
+#endif
+        }
+
+        // Index line breaks of the latest mapping in blocks, publishing every block
+        // Stops once the mapping is indexed or every view of the file was closed
+        inline void index_file(std::weak_ptr<FileIndex> weak_file) {
+            static const uint64_t block = 4 << 20;
+            std::vector<uint64_t> found;
+            while(true) {
+                std::shared_ptr<FileIndex> file = weak_file.lock();
+                if(!file) {
+                    return;
+                }
+                std::shared_ptr<const FileMapping> mapping;
+                uint64_t start, newlines, tail, restarts;
+                {
+                    std::lock_guard<std::mutex> lock(file->mutex);
+                    if(file->indexed >= file->mapping->size) {
+                        file->indexing = false;
+                        return;
+                    }
+                    mapping = file->mapping;
+                    start = file->indexed;
+                    newlines = file->newlines;
+                    tail = file->tail;
+                    restarts = file->restarts;
+                }
+                const char *data = mapping->data;
+                const char *position = data + start;
+                const char *end = data + std::min(mapping->size, start + block);
+                found.clear();
+                // memchr is vectorized by the C library
+                while((position = (const char *)memchr(position, '\n', end - position)) != nullptr) {
+                    position++;
+                    newlines++;
+                    tail = position - data;
+                    if(newlines % FileIndex::stride == 0) {
+                        found.push_back(tail);
+                    }
+                }
+                release_pages(*mapping, start, end - data);
+                std::lock_guard<std::mutex> lock(file->mutex);
+                if(file->restarts == restarts) {
+                    file->checkpoints.insert(file->checkpoints.end(), found.begin(), found.end());
+                    file->newlines = newlines;
+                    file->indexed = end - data;
+                    file->tail = tail;
+                }
+            }
+        }
+
+        // Start a worker indexing file unless one is running, mutex must be held
+        inline void start_indexing(const std::shared_ptr<FileIndex> &file) {
+            if(file->indexing || file->indexed >= file->mapping->size) {
+                return;
+            }
+            file->indexing = true;
+            std::thread(index_file, std::weak_ptr<FileIndex>(file)).detach();
+        }
+    }
+
+    inline void FileView::open(const std::string &path) {
+        std::shared_ptr<detail::FileIndex> opened = std::make_shared<detail::FileIndex>();
+#ifdef IS_WIN
+        opened->handle = CreateFileA(
+            path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL
+        );
+        if(opened->handle == INVALID_HANDLE_VALUE) {
+            throw TUIException("Cannot open file: " + path);
+        }
+#elif defined(IS_POSIX)
+        opened->fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if(opened->fd < 0) {
+            throw TUIException("Cannot open file: " + path + ": " + strerror(errno));
+        }
+#endif
+        uint64_t bytes = 0;
+        if(!detail::file_size(*opened, bytes)) {
+            throw TUIException("Cannot read size of file: " + path);
+        }
+        opened->mapping = detail::map_file(*opened, bytes);
+        {
+            std::lock_guard<std::mutex> lock(opened->mutex);
+            detail::start_indexing(opened);
+        }
+        file = opened;
+        first_line = 0;
+        polled_lines = 0;
+        polled_bytes = bytes;
+        touch();
+    }
+
+    inline void FileView::close() {
+        file.reset();
+        first_line = 0;
+        polled_lines = 0;
+        polled_bytes = 0;
+        touch();
+    }
+
+    inline uint64_t FileView::size() const {
+        if(!file) {
+            return 0;
+        }
+        std::lock_guard<std::mutex> lock(file->mutex);
+        // Once everything is indexed, text after the last line break is a line too
+        bool unterminated = file->indexed == file->mapping->size && file->indexed > file->tail;
+        return file->newlines + (unterminated ? 1 : 0);
+    }
+
+    inline bool FileView::busy() const {
+        if(!file) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(file->mutex);
+        return file->indexing;
+    }
+
+    inline bool FileView::poll() {
+        if(!file) {
+            return false;
+        }
+        uint64_t bytes = polled_bytes;
+        if(detail::file_size(*file, bytes)) {
+            std::lock_guard<std::mutex> lock(file->mutex);
+            if(bytes != file->mapping->size) {
+                if(bytes < file->indexed) {
+                    // Shrunk between two reads without a page being touched, index again from the start
+                    // Not a safe way to truncate, see FileView
+                    file->checkpoints.assign(1, 0);
+                    file->newlines = 0;
+                    file->indexed = 0;
+                    file->tail = 0;
+                    file->restarts++;
+                }
+                file->mapping = detail::map_file(*file, bytes);
+                detail::start_indexing(file);
+            }
+        }
+        uint64_t lines = size();
+        if(lines == polled_lines && bytes == polled_bytes) {
+            return false;
+        }
+        polled_lines = lines;
+        polled_bytes = bytes;
+        if(follow) {
+            first_line = lines;
+        }
+        scroll_up(0);
+        touch();
+        return true;
+    }
+
+    inline void FileView::scroll_up(int factor) {
+        int64_t lines = (int64_t)size();
+        int64_t last = std::max<int64_t>(0, lines - (height - 2));
+        first_line = (uint64_t)std::max<int64_t>(0, std::min<int64_t>(last, (int64_t)first_line - factor));
+        if(factor > 0) {
+            follow = false;
+        }
+    }
+
+    // Scrolling to the last line follows lines added later
+    inline void FileView::scroll_down(int factor) {
+        scroll_up(-factor);
+        int64_t lines = (int64_t)size();
+        if(factor > 0 && (int64_t)first_line >= lines - (height - 2)) {
+            follow = true;
+        }
+    }
+
+    // Fuzzy filtering
+    // Rows are matched on worker threads, results are sorted by score, best first.
+    class FuzzyFilter {
+        public:
+            // Match with threads workers, one per hardware thread if 0
+            FuzzyFilter(unsigned threads = 0) : threads(threads) {
+                if(this->threads == 0) {
+                    this->threads = std::max(1u, std::thread::hardware_concurrency());
+                }
+            }
+
+            ~FuzzyFilter() {
+                cancel();
+            }
+
+            // Search a copy of rows
+            void set_rows(const std::vector<std::string> &rows) {
+                set_rows(std::make_shared<const std::vector<std::string> >(rows));
+            }
+
+            // Search rows without copying them
+            void set_rows(std::shared_ptr<const std::vector<std::string> > rows_) {
+                cancel();
+                rows = rows_;
+                // Masks of character classes let most rows be rejected without matching
+                std::shared_ptr<std::vector<uint64_t> > row_masks = std::make_shared<std::vector<uint64_t> >(rows->size());
+                parallel_for(rows->size(), [&](size_t, size_t first, size_t last) {
+                    for(size_t i = first; i < last; i++) {
+                        (*row_masks)[i] = detail::fuzzy_mask((*rows)[i].c_str(), (*rows)[i].length());
+                    }
+                });
+                masks = row_masks;
+                result.reset();
+                result_scores.reset();
+                result_ordered.reset();
+                result_text.clear();
+            }
+
+            // Start matching text, poll() shows the result
+            // Text extending the text of the current result only searches its rows
+            void search(const std::string &text) {
+                cancel();
+                if(text.empty()) {
+                    result.reset();
+                    result_scores.reset();
+                    result_ordered.reset();
+                    result_text.clear();
+                    return;
+                }
+                std::shared_ptr<Job> next = std::make_shared<Job>();
+                next->text = text;
+                std::shared_ptr<const std::vector<uint32_t> > base;
+                if(!result_text.empty() && text.compare(0, result_text.length(), result_text) == 0) {
+                    // Rows not matching the shorter text cannot match the longer one,
+                    // they are searched in row order so memory is read in order
+                    base = result_ordered;
+                }
+                std::shared_ptr<const std::vector<std::string> > rows_ = rows;
+                std::shared_ptr<const std::vector<uint64_t> > masks_ = masks;
+                unsigned threads_ = threads;
+                std::thread([next, rows_, masks_, base, threads_]() {
+                    run(*next, *rows_, *masks_, base.get(), threads_);
+                }).detach();
+                job = next;
+            }
+
+            // Stop the running search, the current result stays
+            void cancel() {
+                if(job) {
+                    job->cancelled = true;
+                    job.reset();
+                }
+            }
+
+            // Return true while a search runs
+            bool busy() const {
+                return job && !job->done;
+            }
+
+            // Take the result of a finished search, returns true if the result changed
+            bool poll() {
+                if(!job || !job->done) {
+                    return false;
+                }
+                result = std::make_shared<const std::vector<uint32_t> >(std::move(job->rows));
+                result_scores = std::make_shared<const std::vector<int> >(std::move(job->scores));
+                result_ordered = std::make_shared<const std::vector<uint32_t> >(std::move(job->ordered));
+                result_text = job->text;
+                job.reset();
+                return true;
+            }
+
+            // Return matching rows best first, or null if every row is shown
+            std::shared_ptr<const std::vector<uint32_t> > matches() const {
+                return result;
+            }
+
+            // Return the score of every match
+            std::shared_ptr<const std::vector<int> > scores() const {
+                return result_scores;
+            }
+
+            // Return the text the current result matches
+            const std::string &text() const {
+                return result_text;
+            }
+
+            // Show the current result in list, which must hold the searched rows
+            // Throws TUIException if list has another number of rows, the view would index past them
+            void apply(List &list) const {
+                if(list.rows.size() != rows->size()) {
+                    throw TUIException("List does not hold the rows of the filter");
+                }
+                list.view = result;
+                list.highlight = result_text;
+                list.first_element = std::max(0, std::min(list.first_element, (int)list.visible_size() - (list.height - 2)));
+                list.touch();
+            }
+
+        private:
+            struct Job {
+                std::string text;
+                std::atomic<bool> done{false};
+                std::atomic<bool> cancelled{false};
+                std::vector<uint32_t> rows; // Owned by the worker until done
+                std::vector<int> scores;
+                std::vector<uint32_t> ordered; // Matching rows in row order
+            };
+
+            unsigned threads;
+            std::shared_ptr<const std::vector<std::string> > rows = std::make_shared<const std::vector<std::string> >();
+            std::shared_ptr<const std::vector<uint64_t> > masks = std::make_shared<const std::vector<uint64_t> >();
+            std::shared_ptr<Job> job;
+            std::shared_ptr<const std::vector<uint32_t> > result;
+            std::shared_ptr<const std::vector<int> > result_scores;
+            std::shared_ptr<const std::vector<uint32_t> > result_ordered;
+            std::string result_text;
+
+            // Return the number of parts count items are split into
+            static size_t part_count(size_t count, unsigned threads) {
+                return std::max<size_t>(1, std::min<size_t>(threads, count / 4096));
+            }
+
+            // Call work(part, first, last) on contiguous ranges of count items on up to threads threads
+            template<typename Work>
+            static void parallel_for(size_t count, unsigned threads, Work work) {
+                size_t parts = part_count(count, threads);
+                std::vector<std::thread> workers;
+                for(size_t part = 1; part < parts; part++) {
+                    workers.emplace_back(work, part, count * part / parts, count * (part + 1) / parts);
+                }
+                work(0, 0, count / parts);
+                for(std::thread &worker : workers) {
+                    worker.join();
+                }
+            }
+
+            template<typename Work>
+            void parallel_for(size_t count, Work work) {
+                parallel_for(count, threads, work);
+            }
+
+            // Match rows, or the rows of base, against the text of job
+            static void run(Job &job, const std::vector<std::string> &rows, const std::vector<uint64_t> &masks,
+                    const std::vector<uint32_t> *base, unsigned threads) {
+                std::string query;
+                for(char c : job.text) {
+                    query += detail::fold_case(c);
+                }
+                uint64_t needed = detail::fuzzy_mask(query.c_str(), query.length());
+                size_t count = base ? base->size() : rows.size();
+                struct Part {
+                    std::vector<uint32_t> rows;
+                    std::vector<int> scores;
+                };
+                std::vector<Part> parts(part_count(count, threads));
+                parallel_for(count, threads, [&](size_t index, size_t first, size_t last) {
+                    Part &part = parts[index];
+                    const size_t chunk = 1024;
+                    uint32_t candidates[chunk];
+                    uint8_t passed[chunk];
+                    for(size_t start = first; start < last; start += chunk) {
+                        if(job.cancelled) {
+                            return;
+                        }
+                        size_t size = std::min(chunk, last - start);
+                        for(size_t i = 0; i < size; i++) {
+                            candidates[i] = base ? (*base)[start + i] : (uint32_t)(start + i);
+                        }
+                        // Prefilter on masks, a loop without branches which compilers vectorize
+                        for(size_t i = 0; i < size; i++) {
+                            passed[i] = (masks[candidates[i]] & needed) == needed;
+                        }
+                        for(size_t i = 0; i < size; i++) {
+                            int score;
+                            const std::string &row = rows[candidates[i]];
+                            if(passed[i] && detail::fuzzy_match(row.c_str(), row.length(), query.c_str(), query.length(), score)) {
+                                part.rows.push_back(candidates[i]);
+                                part.scores.push_back(score);
+                            }
+                        }
+                    }
+                });
+                if(job.cancelled) {
+                    return;
+                }
+                // Counting sort by score, best first, keeping the order of equal scores
+                int lowest = INT_MAX;
+                int highest = INT_MIN;
+                size_t matches = 0;
+                for(const Part &part : parts) {
+                    for(int score : part.scores) {
+                        lowest = std::min(lowest, score);
+                        highest = std::max(highest, score);
+                    }
+                    matches += part.scores.size();
+                }
+                job.rows.resize(matches);
+                job.scores.resize(matches);
+                job.ordered.reserve(matches);
+                for(const Part &part : parts) {
+                    job.ordered.insert(job.ordered.end(), part.rows.begin(), part.rows.end());
+                }
+                if(matches > 0) {
+                    std::vector<size_t> offsets(highest - lowest + 2, 0);
+                    for(const Part &part : parts) {
+                        for(int score : part.scores) {
+                            offsets[highest - score + 1]++;
+                        }
+                    }
+                    for(size_t i = 1; i < offsets.size(); i++) {
+                        offsets[i] += offsets[i - 1];
+                    }
+                    for(const Part &part : parts) {
+                        for(size_t i = 0; i < part.rows.size(); i++) {
+                            size_t position = offsets[highest - part.scores[i]]++;
+                            job.rows[position] = part.rows[i];
+                            job.scores[position] = part.scores[i];
+                        }
+                    }
+                }
+                job.done = true;
+            }
+    };
+
+    // Frame recording
+    // A recording starts with the bytes "TUIR" and a version byte,
+    // followed by one record per frame:
+    //   elapsed microseconds, columns, rows, the number of new styles and their
+    //   foreground, background and attributes, run count, then for every run
+    //   the number of unchanged cells skipped, the run length and its cells
+    // Integers are stored as LEB128 varints and each cell as a glyph byte
+    // followed by its style id as a varint. New styles take the next free ids,
+    // version 1 recordings have no styles.
+    namespace detail {
+        inline void write_varint(std::vector<uint8_t> &buffer, uint64_t value) {
+            while(value >= 0x80) {
+                buffer.push_back((uint8_t)(value | 0x80));
+                value >>= 7;
+            }
+            buffer.push_back((uint8_t)value);
+        }
+
+        inline uint64_t read_varint(const uint8_t *&position, const uint8_t *end) {
+            uint64_t value = 0;
+            for(int shift = 0; shift < 64; shift += 7) {
+                if(position == end) {
+                    throw TUIException("Recording is truncated");
+                }
+                uint8_t byte = *position++;
+                value |= (uint64_t)(byte & 0x7F) << shift;
+                if((byte & 0x80) == 0) {
+                    return value;
+                }
+            }
+            throw TUIException("Recording contains an invalid integer");
+        }
+
+        constexpr char recording_magic[4] = {'T', 'U', 'I', 'R'};
+        constexpr uint8_t recording_version = 2;
+
+        // Return the id of style in the style table of target, targets without one get id
+        template<typename Target>
+        auto target_style(Target &target, const StyleTable &styles, short id, int) -> decltype(target.styles.import(styles, id)) {
+            return target.styles.import(styles, id);
+        }
+
+        template<typename Target>
+        short target_style(Target &, const StyleTable &, short id, long) {
+            return id;
+        }
+    }
+
+    // Write frame diffs to a compact binary file
+    class FrameRecorder : public FrameSink {
+        public:
+            FrameRecorder(const std::string &path, size_t buffer_size = 1 << 16) : io_buffer(buffer_size) {
+                file = fopen(path.c_str(), "wb");
+                if(file == NULL) {
+                    throw TUIException("Unable to open recording file: " + path);
+                }
+                setvbuf(file, io_buffer.data(), _IOFBF, io_buffer.size());
+                fwrite(detail::recording_magic, 1, sizeof(detail::recording_magic), file);
+                fwrite(&detail::recording_version, 1, 1, file);
+                last_time = std::chrono::steady_clock::now();
+            }
+
+            FrameRecorder(const FrameRecorder &) = delete;
+            FrameRecorder &operator=(const FrameRecorder &) = delete;
+
+            ~FrameRecorder() {
+                close();
+            }
+
+            // Flush and close the recording
+            void close() {
+                if(file != NULL) {
+                    fclose(file);
+                    file = NULL;
+                }
+            }
+
+            // Append the difference between cells and the previous frame
+            void submit(const Cell *cells, int columns, int rows, const StyleTable *styles = nullptr) override {
+                auto now = std::chrono::steady_clock::now();
+                uint64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - last_time).count();
+                last_time = now;
+                size_t size = (size_t)columns * rows;
+                if(columns != previous_columns || rows != previous_rows) {
+                    // Dimensions changed, diff against a blank frame
+                    previous.assign(size, Cell{});
+                    previous_columns = columns;
+                    previous_rows = rows;
+                }
+                // Find runs of changed cells
+                runs.clear();
+                size_t i = 0;
+                while(i < size) {
+                    if(cells[i] == previous[i]) {
+                        i++;
+                        continue;
+                    }
+                    size_t start = i;
+                    while(i < size && cells[i] != previous[i]) {
+                        i++;
+                    }
+                    runs.push_back({start, i - start});
+                }
+                // Encode frame
+                record.clear();
+                detail::write_varint(record, elapsed);
+                detail::write_varint(record, columns);
+                detail::write_varint(record, rows);
+                // Styles interned since the last frame
+                int style_count = styles != nullptr ? std::max(styles->size() - recorded_styles, 0) : 0;
+                detail::write_varint(record, style_count);
+                for(int id = recorded_styles; id < recorded_styles + style_count; id++) {
+                    Style style = styles->get(id);
+                    detail::write_varint(record, (uint32_t)style.foreground);
+                    detail::write_varint(record, (uint32_t)style.background);
+                    detail::write_varint(record, (uint32_t)style.attributes);
+                }
+                recorded_styles += style_count;
+                detail::write_varint(record, runs.size());
+                size_t position = 0;
+                for(const Run &run : runs) {
+                    detail::write_varint(record, run.start - position);
+                    detail::write_varint(record, run.length);
+                    for(size_t j = run.start; j < run.start + run.length; j++) {
+                        record.push_back((uint8_t)cells[j].glyph);
+                        detail::write_varint(record, (uint16_t)cells[j].color);
+                    }
+                    position = run.start + run.length;
+                }
+                std::copy(cells, cells + size, previous.begin());
+                if(file != NULL) {
+                    fwrite(record.data(), 1, record.size(), file);
+                }
+            }
+
+        private:
+            struct Run {
+                size_t start;
+                size_t length;
+            };
+
+            FILE *file = NULL;
+            std::vector<char> io_buffer;  // Buffer used by file
+            std::vector<uint8_t> record;  // Encoded frame
+            std::vector<Run> runs;        // Changed cell runs of current frame
+            std::vector<Cell> previous;   // Last recorded frame
+            int previous_columns = -1;
+            int previous_rows = -1;
+            int recorded_styles = StyleTable::plain_styles; // Styles written so far
+            std::chrono::steady_clock::time_point last_time;
+    };
+
+    enum ReplaySpeed {
+        REALTIME,   // Wait between frames as recorded
+        UNTHROTTLED // Replay frames as fast as possible
+    };
+
+    // Read a recording and replay it against any target
+    // providing draw_char(x, y, c, color) and render()
+    // Styles are interned in the styles member of targets having one, like Window.
+    class FrameReplayer {
+        public:
+            FrameReplayer(const std::string &path) {
+                FILE *file = fopen(path.c_str(), "rb");
+                if(file == NULL) {
+                    throw TUIException("Unable to open recording file: " + path);
+                }
+                fseek(file, 0, SEEK_END);
+                long length = ftell(file);
+                fseek(file, 0, SEEK_SET);
+                data.resize(length > 0 ? length : 0);
+                size_t read = fread(data.data(), 1, data.size(), file);
+                fclose(file);
+                if(
+                    read != data.size() ||
+                    data.size() < sizeof(detail::recording_magic) + 1 ||
+                    !std::equal(detail::recording_magic, detail::recording_magic + 4, data.begin()) ||
+                    data[4] < 1 || data[4] > detail::recording_version) {
+                    throw TUIException("Invalid recording file: " + path);
+                }
+                version = data[4];
+                rewind();
+            }
+
+            // Restart from the first frame
+            void rewind() {
+                position = data.data() + sizeof(detail::recording_magic) + 1;
+                cells.clear();
+                styles = StyleTable();
+                columns_ = 0;
+                rows_ = 0;
+            }
+
+            // Apply the next frame to target, return false at the end of the recording
+            template<typename Target>
+            bool step(Target &target, ReplaySpeed speed = UNTHROTTLED) {
+                const uint8_t *end = data.data() + data.size();
+                if(position == end) {
+                    return false;
+                }
+                uint64_t elapsed = detail::read_varint(position, end);
+                int columns = (int)detail::read_varint(position, end);
+                int rows = (int)detail::read_varint(position, end);
+                uint64_t style_count = version >= 2 ? detail::read_varint(position, end) : 0;
+                for(uint64_t i = 0; i < style_count; i++) {
+                    Style style;
+                    style.foreground = (int)detail::read_varint(position, end);
+                    style.background = (int)detail::read_varint(position, end);
+                    style.attributes = (int)detail::read_varint(position, end);
+                    int expected = styles.size();
+                    if(StyleTable::is_plain(style) || expected >= StyleTable::capacity || styles.intern(style) != expected) {
+                        throw TUIException("Recording contains an invalid style");
+                    }
+                }
+                uint64_t run_count = detail::read_varint(position, end);
+                if(columns != columns_ || rows != rows_) {
+                    cells.assign((size_t)columns * rows, Cell{});
+                    columns_ = columns;
+                    rows_ = rows;
+                }
+                if(speed == REALTIME) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(elapsed));
+                }
+                size_t index = 0;
+                for(uint64_t i = 0; i < run_count; i++) {
+                    index += detail::read_varint(position, end);
+                    uint64_t length = detail::read_varint(position, end);
+                    if(index + length > cells.size()) {
+                        throw TUIException("Recording run is out of bounds");
+                    }
+                    for(uint64_t j = 0; j < length; j++, index++) {
+                        if(position == end) {
+                            throw TUIException("Recording is truncated");
+                        }
+                        cells[index].glyph = (char)*position++;
+                        cells[index].color = (short)detail::read_varint(position, end);
+                        short color = detail::target_style(target, styles, cells[index].color, 0);
+                        target.draw_char(index % columns_, index / columns_, cells[index].glyph, color);
+                    }
+                }
+                target.render();
+                return true;
+            }
+
+            // Replay every remaining frame and return the number of frames
+            template<typename Target>
+            size_t replay(Target &target, ReplaySpeed speed = UNTHROTTLED) {
+                size_t frames = 0;
+                while(step(target, speed)) {
+                    frames++;
+                }
+                return frames;
+            }
+
+            // Return cells of the last replayed frame
+            inline const std::vector<Cell> &get_cells() const {
+                return cells;
+            }
+
+            // Return the styles of the cells
+            inline const StyleTable &get_styles() const {
+                return styles;
+            }
+
+            inline int columns() const {
+                return columns_;
+            }
+
+            inline int rows() const {
+                return rows_;
+            }
+
+        private:
+            std::vector<uint8_t> data;     // Whole recording
+            const uint8_t *position;       // Start of next frame
+            std::vector<Cell> cells;       // Last replayed frame
+            StyleTable styles;             // Styles recorded so far
+            uint8_t version;
+            int columns_ = 0;
+            int rows_ = 0;
+    };
+#ifdef IS_POSIX
+    namespace detail {
+        // Append the SGR parameters of color, base is 30 for foreground and 40 for background
+        inline void append_sgr_color(std::string &out, int color, int base) {
+            char parameters[24];
+            if(color < 8) {
+                snprintf(parameters, sizeof(parameters), ";%d", base + color);
+            } else if(color < 16) {
+                snprintf(parameters, sizeof(parameters), ";%d", base + 60 + color - 8);
+            } else if(color < 256) {
+                snprintf(parameters, sizeof(parameters), ";%d;5;%d", base + 8, color);
+            } else {
+                snprintf(
+                    parameters, sizeof(parameters), ";%d;2;%d;%d;%d",
+                    base + 8, (color >> 16) & 0xFF, (color >> 8) & 0xFF, color & 0xFF
+                );
+            }
+            out += parameters;
+        }
+
+        // Append the escape sequence selecting style
+        inline void append_sgr(std::string &out, const Style &style) {
+            out += "\x1B[0";
+            const int codes[][2] = {
+                {ATTR_BOLD, 1}, {ATTR_DIM, 2}, {ATTR_ITALIC, 3}, {ATTR_UNDERLINE, 4}, {ATTR_REVERSE, 7}
+            };
+            for(const auto &code : codes) {
+                if(style.attributes & code[0]) {
+                    out += ';';
+                    out += (char)('0' + code[1]);
+                }
+            }
+            append_sgr_color(out, style.foreground, 30);
+            append_sgr_color(out, style.background, 40);
+            out += 'm';
+        }
+    }
+
+    // Append escape sequences which turn the terminal showing previous into cells
+    // Without previous the whole frame is drawn after clearing the screen.
+    // Color 0 is the default terminal color, other colors are looked up in styles.
+    inline void encode_frame(const Cell *previous, const Cell *cells, int columns, int rows, std::string &out, const StyleTable *styles = nullptr) {
+        int current_color = -1;
+        int cursor = -1; // Index of the cell the terminal cursor is on
+        if(previous == nullptr) {
+            out += "\x1B[0m\x1B[H\x1B[2J";
+            current_color = 0;
+            cursor = 0;
+        }
+        char sequence[32];
+        for(int i = 0; i < columns * rows; i++) {
+            const Cell &cell = cells[i];
+            if(previous != nullptr ? cell == previous[i] : cell == Cell{}) {
+                continue;
+            }
+            if(cursor != i) {
+                // Rewriting a short gap of same colored cells is cheaper than moving the cursor
+                bool bridge = cursor >= 0 && i - cursor <= 4 && cursor / columns == i / columns;
+                for(int j = cursor; bridge && j < i; j++) {
+                    bridge = cells[j].color == current_color;
+                }
+                if(bridge) {
+                    for(int j = cursor; j < i; j++) {
+                        out += cells[j].glyph != 0 ? cells[j].glyph : ' ';
+                    }
+                } else {
+                    snprintf(sequence, sizeof(sequence), "\x1B[%d;%dH", i / columns + 1, i % columns + 1);
+                    out += sequence;
+                }
+            }
+            if(cell.color != current_color) {
+                if(cell.color == 0) {
+                    out += "\x1B[0m";
+                } else {
+                    detail::append_sgr(out, styles != nullptr ? styles->get(cell.color) : StyleTable::plain_style(cell.color));
+                }
+                current_color = cell.color;
+            }
+            out += cell.glyph != 0 ? cell.glyph : ' ';
+            // Cursor does not move to the next row after the last column
+            cursor = (i + 1) % columns == 0 ? -1 : i + 1;
+        }
+    }
+
+    // Serve rendered frames to clients connected to a Unix domain socket
+    // Each frame diff is encoded once and the same bytes are queued for every client.
+    // Clients which fall more than max_pending bytes behind, and new clients,
+    // skip the queued diffs and receive a full frame instead.
+    class BroadcastServer : public FrameSink {
+        public:
+            BroadcastServer(const std::string &path_, size_t max_pending_ = 1 << 20) : path(path_), max_pending(max_pending_) {
+                struct sockaddr_un address;
+                if(path.size() >= sizeof(address.sun_path)) {
+                    throw TUIException("Socket path is too long: " + path);
+                }
+                listener = socket(AF_UNIX, SOCK_STREAM, 0);
+                if(listener < 0) {
+                    throw TUIException("Unable to create socket");
+                }
+                memset(&address, 0, sizeof(address));
+                address.sun_family = AF_UNIX;
+                strcpy(address.sun_path, path.c_str());
+                unlink(path.c_str());
+                if(bind(listener, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(listener, 16) < 0) {
+                    ::close(listener);
+                    throw TUIException("Unable to listen on socket: " + path);
+                }
+                fcntl(listener, F_SETFL, fcntl(listener, F_GETFL) | O_NONBLOCK);
+            }
+
+            BroadcastServer(const BroadcastServer &) = delete;
+            BroadcastServer &operator=(const BroadcastServer &) = delete;
+
+            ~BroadcastServer() {
+                for(Client &client : clients) {
+                    ::close(client.socket);
+                }
+                ::close(listener);
+                unlink(path.c_str());
+            }
+
+            // Encode the frame once and queue it for every client
+            void submit(const Cell *cells, int columns, int rows, const StyleTable *styles_ = nullptr) override {
+                accept_clients();
+                if(styles_ != nullptr && styles_->size() != styles.size()) {
+                    // Tables only grow, so they are copied when new styles appear
+                    styles = *styles_;
+                }
+                size_t size = (size_t)columns * rows;
+                bool resized = columns != columns_ || rows != rows_;
+                columns_ = columns;
+                rows_ = rows;
+                auto diff = std::make_shared<std::string>();
+                encode_frame(resized ? nullptr : previous.data(), cells, columns, rows, *diff, &styles);
+                previous.assign(cells, cells + size);
+                full_frame.reset();
+                for(Client &client : clients) {
+                    if(client.resync || client.pending + diff->size() > max_pending) {
+                        resync(client);
+                    } else if(!diff->empty()) {
+                        client.queue.push_back(diff);
+                        client.pending += diff->size();
+                    }
+                }
+                serve();
+            }
+
+            // Accept new clients and send queued bytes without blocking
+            void serve() {
+                accept_clients();
+                for(Client &client : clients) {
+                    if(client.resync && !previous.empty()) {
+                        resync(client);
+                    }
+                    while(!client.queue.empty()) {
+                        const std::string &bytes = *client.queue.front();
+                        ssize_t sent = send(client.socket, bytes.data() + client.offset, bytes.size() - client.offset, MSG_NOSIGNAL);
+                        if(sent < 0) {
+                            if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                                client.closed = true;
+                            }
+                            break;
+                        }
+                        client.offset += sent;
+                        client.pending -= sent;
+                        if(client.offset < bytes.size()) {
+                            break;
+                        }
+                        client.queue.pop_front();
+                        client.offset = 0;
+                    }
+                }
+                clients.erase(std::remove_if(clients.begin(), clients.end(), [](const Client &client) {
+                    if(client.closed) {
+                        ::close(client.socket);
+                    }
+                    return client.closed;
+                }), clients.end());
+            }
+
+            // Return number of connected clients
+            inline size_t client_count() const {
+                return clients.size();
+            }
+
+        private:
+            struct Client {
+                int socket;
+                std::deque<std::shared_ptr<const std::string>> queue; // Encoded frames to send
+                size_t offset = 0;   // Bytes of the first queued frame already sent
+                size_t pending = 0;  // Bytes queued and not yet sent
+                bool resync = true;  // Client needs a full frame
+                bool closed = false;
+            };
+
+            void accept_clients() {
+                int client_socket;
+                while((client_socket = accept(listener, NULL, NULL)) >= 0) {
+                    fcntl(client_socket, F_SETFL, fcntl(client_socket, F_GETFL) | O_NONBLOCK);
+                    Client client;
+                    client.socket = client_socket;
+                    clients.push_back(client);
+                }
+            }
+
+            // Replace unsent diffs of client with a full frame
+            void resync(Client &client) {
+                if(!full_frame) {
+                    auto frame = std::make_shared<std::string>();
+                    encode_frame(nullptr, previous.data(), columns_, rows_, *frame, &styles);
+                    full_frame = frame;
+                }
+                // A partly sent frame has to be completed first
+                size_t keep = client.offset > 0 ? 1 : 0;
+                while(client.queue.size() > keep) {
+                    client.pending -= client.queue.back()->size();
+                    client.queue.pop_back();
+                }
+                client.queue.push_back(full_frame);
+                client.pending += full_frame->size();
+                client.resync = false;
+            }
+
+            std::string path;
+            size_t max_pending;     // Most bytes queued for a client before it is resynchronized
+            int listener;
+            std::vector<Client> clients;
+            std::vector<Cell> previous; // Last submitted frame
+            StyleTable styles;          // Styles of the submitted frames
+            std::shared_ptr<const std::string> full_frame; // Full encoding of previous, if needed
+            int columns_ = 0;
+            int rows_ = 0;
+    };
+#endif
+
+#ifdef TUI_COROUTINES
+    // Coroutine returning T, started when awaited or spawned on an EventLoop
+    template<typename T = void>
+    class Task;
+
+    namespace detail {
+        struct TaskPromiseBase {
+            std::coroutine_handle<> continuation; // Coroutine awaiting this one
+            std::exception_ptr exception;
+
+            struct FinalAwaiter {
+                bool await_ready() noexcept {
+                    return false;
+                }
+
+                // Resume the awaiting coroutine without growing the stack
+                template<typename Promise>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+                    std::coroutine_handle<> continuation = handle.promise().continuation;
+                    return continuation ? continuation : std::noop_coroutine();
+                }
+
+                void await_resume() noexcept {}
+            };
+
+            std::suspend_always initial_suspend() noexcept {
+                return {};
+            }
+
+            FinalAwaiter final_suspend() noexcept {
+                return {};
+            }
+
+            void unhandled_exception() {
+                exception = std::current_exception();
+            }
+        };
+
+        template<typename T>
+        struct TaskPromise : TaskPromiseBase {
+            std::optional<T> value;
+
+            Task<T> get_return_object();
+
+            void return_value(T result) {
+                value = std::move(result);
+            }
+
+            T result() {
+                if(exception) {
+                    std::rethrow_exception(exception);
+                }
+                return std::move(*value);
+            }
+        };
+
+        template<>
+        struct TaskPromise<void> : TaskPromiseBase {
+            Task<void> get_return_object();
+
+            void return_void() {}
+
+            void result() {
+                if(exception) {
+                    std::rethrow_exception(exception);
+                }
+            }
+        };
+
+        // Value or exception of work run on another thread
+        template<typename R>
+        struct Result {
+            std::optional<R> value;
+            std::exception_ptr exception;
+
+            void run(std::function<R()> &work) {
+                try {
+                    value.emplace(work());
+                } catch(...) {
+                    exception = std::current_exception();
+                }
+            }
+
+            R get() {
+                if(exception) {
+                    std::rethrow_exception(exception);
+                }
+                return std::move(*value);
+            }
+        };
+
+        template<>
+        struct Result<void> {
+            std::exception_ptr exception;
+
+            void run(std::function<void()> &work) {
+                try {
+                    work();
+                } catch(...) {
+                    exception = std::current_exception();
+                }
+            }
+
+            void get() {
+                if(exception) {
+                    std::rethrow_exception(exception);
+                }
+            }
+        };
+    }
+
+    template<typename T>
+    class Task {
+        public:
+            typedef detail::TaskPromise<T> promise_type;
+
+            Task() {}
+
+            explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+            Task(Task &&other) noexcept : handle(other.handle) {
+                other.handle = nullptr;
+            }
+
+            Task &operator=(Task &&other) noexcept {
+                if(this != &other) {
+                    destroy();
+                    handle = other.handle;
+                    other.handle = nullptr;
+                }
+                return *this;
+            }
+
+            Task(const Task &) = delete;
+            Task &operator=(const Task &) = delete;
+
+            ~Task() {
+                destroy();
+            }
+
+            // Return true if the coroutine ran to completion
+            bool done() const {
+                return !handle || handle.done();
+            }
+
+            // Start the coroutine and resume the awaiting one with its result
+            bool await_ready() const noexcept {
+                return done();
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            // Throws TUIException for a task without a coroutine, e.g. a moved from one
+            T await_resume() {
+                if(!handle) {
+                    throw TUIException("Task has no coroutine");
+                }
+                return handle.promise().result();
+            }
+
+        private:
+            friend class EventLoop;
+
+            std::coroutine_handle<promise_type> handle;
+
+            void destroy() {
+                if(handle) {
+                    handle.destroy();
+                    handle = nullptr;
+                }
+            }
+    };
+
+    namespace detail {
+        template<typename T>
+        inline Task<T> TaskPromise<T>::get_return_object() {
+            return Task<T>(std::coroutine_handle<TaskPromise<T> >::from_promise(*this));
+        }
+
+        inline Task<void> TaskPromise<void>::get_return_object() {
+            return Task<void>(std::coroutine_handle<TaskPromise<void> >::from_promise(*this));
+        }
+    }
+
+    // Single threaded executor resuming coroutines on the thread calling run()
+    // Coroutines await input events, timers and work done on other threads,
+    // the loop sleeps in Window::wait_event while none of them can make progress.
+    class EventLoop {
+        public:
+            EventLoop(Window &window) : window(window), shared(std::make_shared<Shared>()) {
+                shared->window = &window;
+            }
+
+            EventLoop(const EventLoop &) = delete;
+            EventLoop &operator=(const EventLoop &) = delete;
+
+            ~EventLoop() {
+                for(auto &sleeper : sleeping) {
+                    window.cancel_timer(sleeper.second);
+                }
+                // Work still running on other threads must not wake the window anymore
+                std::lock_guard<std::mutex> lock(shared->mutex);
+                shared->window = nullptr;
+            }
+
+            // Start task on the next iteration of run()
+            void spawn(Task<void> task) {
+                ready.push_back(task.handle);
+                tasks.push_back(std::move(task));
+            }
+
+            // Make run() return after the current iteration
+            void stop() {
+                stopped = true;
+            }
+
+            // Resume coroutines until every spawned task finished or stop() is called
+            // draw is called before the window is rendered after each wake up.
+            // Exceptions escaping a spawned task are rethrown
+            void run(std::function<void()> draw = nullptr) {
+                stopped = false;
+                while(true) {
+                    while(!ready.empty()) {
+                        std::coroutine_handle<> handle = ready.front();
+                        ready.pop_front();
+                        handle.resume();
+                    }
+                    collect();
+                    if(stopped || tasks.empty()) {
+                        break;
+                    }
+                    if(draw) {
+                        draw();
+                    }
+                    window.render();
+                    Event event;
+                    if(window.wait_event(event)) {
+                        dispatch(event);
+                    }
+                    std::lock_guard<std::mutex> lock(shared->mutex);
+                    ready.insert(ready.end(), shared->posted.begin(), shared->posted.end());
+                    shared->posted.clear();
+                }
+            }
+
+            // Awaitable resuming with the next input event
+            // Events arriving while no coroutine waits are queued, the oldest are dropped when full
+            class NextEvent {
+                public:
+                    NextEvent(EventLoop &loop) : loop(loop) {}
+
+                    bool await_ready() {
+                        if(loop.events.empty()) {
+                            return false;
+                        }
+                        event = loop.events.front();
+                        loop.events.pop_front();
+                        return true;
+                    }
+
+                    void await_suspend(std::coroutine_handle<> handle) {
+                        loop.waiters.push_back(std::make_pair(handle, &event));
+                    }
+
+                    Event await_resume() {
+                        return event;
+                    }
+
+                private:
+                    EventLoop &loop;
+                    Event event;
+            };
+
+            NextEvent next_event() {
+                return NextEvent(*this);
+            }
+
+            // Awaitable resuming after delay milliseconds, scheduled on the window timers
+            class Sleep {
+                public:
+                    Sleep(EventLoop &loop, int delay) : loop(loop), delay(delay) {}
+
+                    bool await_ready() const {
+                        return delay <= 0;
+                    }
+
+                    void await_suspend(std::coroutine_handle<> handle) {
+                        EventLoop *self = &loop;
+                        loop.sleeping[handle.address()] = loop.window.set_timeout(delay, [self, handle]() {
+                            self->sleeping.erase(handle.address());
+                            self->ready.push_back(handle);
+                        });
+                    }
+
+                    void await_resume() const {}
+
+                private:
+                    EventLoop &loop;
+                    int delay;
+            };
+
+            Sleep sleep_for(int delay) {
+                return Sleep(*this, delay);
+            }
+
+            template<typename Rep, typename Period>
+            Sleep sleep_for(std::chrono::duration<Rep, Period> delay) {
+                return Sleep(*this, (int)std::chrono::duration_cast<std::chrono::milliseconds>(delay).count());
+            }
+
+            // Awaitable running work on a new thread and resuming with its result on the loop thread
+            template<typename R>
+            class Offload {
+                public:
+                    Offload(EventLoop &loop, std::function<R()> work) : loop(loop), work(std::move(work)), result(std::make_shared<detail::Result<R> >()) {}
+
+                    bool await_ready() const {
+                        return false;
+                    }
+
+                    void await_suspend(std::coroutine_handle<> handle) {
+                        std::shared_ptr<Shared> shared = loop.shared;
+                        std::shared_ptr<detail::Result<R> > result = this->result;
+                        std::function<R()> work = std::move(this->work);
+                        std::thread([shared, result, work, handle]() mutable {
+                            result->run(work);
+                            shared->post(handle);
+                        }).detach();
+                    }
+
+                    R await_resume() {
+                        return result->get();
+                    }
+
+                private:
+                    EventLoop &loop;
+                    std::function<R()> work;
+                    std::shared_ptr<detail::Result<R> > result; // Shared with the thread in case the task is destroyed first
+            };
+
+            template<typename F>
+            Offload<decltype(std::declval<F>()())> run_in_thread(F work) {
+                return Offload<decltype(std::declval<F>()())>(*this, std::move(work));
+            }
+
+        private:
+            // State used by other threads, outlives the loop while they run
+            struct Shared {
+                std::mutex mutex;
+                std::vector<std::coroutine_handle<> > posted; // Coroutines whose work finished
+                Window *window = nullptr;
+
+                void post(std::coroutine_handle<> handle) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if(window != nullptr) {
+                        posted.push_back(handle);
+                        window->wake();
+                    }
+                }
+            };
+
+            static const size_t max_events = 256;
+
+            Window &window;
+            std::shared_ptr<Shared> shared;
+            std::vector<Task<void> > tasks;                // Spawned tasks
+            std::deque<std::coroutine_handle<> > ready;    // Coroutines to resume
+            std::deque<std::pair<std::coroutine_handle<>, Event *> > waiters; // Coroutines awaiting events
+            std::deque<Event> events;                      // Events nobody awaited yet
+            std::unordered_map<void *, TimerWheel::TimerId> sleeping; // Timers of sleeping coroutines
+            bool stopped = false;
+
+            // Hand event to the first waiting coroutine or queue it
+            void dispatch(const Event &event) {
+                if(!waiters.empty()) {
+                    *waiters.front().second = event;
+                    ready.push_back(waiters.front().first);
+                    waiters.pop_front();
+                    return;
+                }
+                if(events.size() == max_events) {
+                    events.pop_front();
+                }
+                events.push_back(event);
+            }
+
+            // Destroy finished tasks and rethrow their exceptions
+            void collect() {
+                for(size_t i = 0; i < tasks.size(); i++) {
+                    if(!tasks[i].done()) {
+                        continue;
+                    }
+                    std::exception_ptr exception = tasks[i].handle.promise().exception;
+                    tasks.erase(tasks.begin() + i);
+                    i--;
+                    if(exception) {
+                        std::rethrow_exception(exception);
+                    }
+                }
+            }
+    };
+#endif
 };
 #endif
\ No newline at end of file
@@ -24,6 +24,1337 @@ TEST_CASE("Widget Set Dimensions", "[widget_set_dimensions]") {
     REQUIRE(list.height == 8);
 }
 
+TEST_CASE("Static Scene", "[static_scene]") {
+    // Test compile time widget storage
+    static_assert(tui::get_color(tui::WHITE, tui::BLACK) == tui::WHITE, "get_color should be constexpr");
+
+    tui::Paragraph paragraph;
+    paragraph.text = "Foo";
+    tui::Gauge gauge;
+    gauge.percent = 50;
+
+    tui::StaticScene scene(paragraph, gauge);
+    REQUIRE(scene.size() == 2);
+    REQUIRE(scene.get<0>().text == "Foo");
+    REQUIRE(scene.get<1>().percent == 50);
+
+    scene.get<1>().percent = 75;
+    REQUIRE(scene.get<1>().percent == 75);
+    REQUIRE(gauge.percent == 50);
+
+    // Adding a scene draws its widgets in order, like adding them one by one
+    scene.get<0>().set_dimensions(0, 0, 10, 3);
+    scene.get<1>().set_dimensions(5, 2, 10, 3);
+    scene.get<1>().bar_color = tui::GREEN;
+    tui::Surface drawn(16, 6);
+    drawn.add(scene);
+    tui::Surface expected(16, 6);
+    expected.add(scene.get<0>(), scene.get<1>());
+    REQUIRE(drawn.at(1, 1).glyph == 'F');
+    REQUIRE(drawn.at(5, 2).glyph == '+');
+    for(int y = 0; y < 6; y++) {
+        for(int x = 0; x < 16; x++) {
+            REQUIRE(drawn.at(x, y) == expected.at(x, y));
+        }
+    }
+}
+
+// Records draw calls made by frame replay
+struct ReplayTarget {
+    int columns;
+    int draws = 0;
+    int renders = 0;
+    std::vector<tui::Cell> cells;
+
+    ReplayTarget(int columns_, int rows_) : columns(columns_), cells(columns_ * rows_) {}
+
+    void draw_char(int x, int y, char c, short color) {
+        cells[y * columns + x] = {c, color};
+        draws++;
+    }
+
+    void render() {
+        renders++;
+    }
+};
+
+TEST_CASE("Frame Recording", "[frame_recording]") {
+    // Test that replaying a recording reproduces every frame
+    // while only drawing the cells that changed
+    const char *path = "test_recording.tuir";
+    std::vector<tui::Cell> first(4 * 3);
+    first[1] = {'a', 7};
+    first[2] = {'b', 7};
+    std::vector<tui::Cell> second = first;
+    second[11] = {'z', 300};
+    {
+        tui::FrameRecorder recorder(path);
+        recorder.submit(first.data(), 4, 3);
+        recorder.submit(second.data(), 4, 3);
+        recorder.submit(second.data(), 4, 3);
+    }
+
+    tui::FrameReplayer replayer(path);
+    ReplayTarget target(4, 3);
+    REQUIRE(replayer.step(target));
+    REQUIRE(target.draws == 2);
+    REQUIRE(replayer.get_cells() == first);
+    REQUIRE(replayer.replay(target) == 2);
+    REQUIRE(target.draws == 3);
+    REQUIRE(target.renders == 3);
+    REQUIRE(target.cells == second);
+    REQUIRE(replayer.columns() == 4);
+    REQUIRE(replayer.rows() == 3);
+    REQUIRE(!replayer.step(target));
+
+    remove(path);
+    REQUIRE_THROWS_AS(tui::FrameReplayer(path), tui::TUIException);
+}
+
+TEST_CASE("Widget Fingerprint", "[widget_fingerprint]") {
+    // Test that fingerprints follow setters and scalar members
+    tui::Gauge gauge;
+    gauge.set_dimensions(0, 0, 10, 3);
+    gauge.percent = 10;
+    gauge.bar_color = tui::GREEN;
+    uint64_t fingerprint = gauge.fingerprint();
+    REQUIRE(gauge.fingerprint() == fingerprint);
+
+    // Copies share the identity of the widget
+    tui::Gauge copy = gauge;
+    REQUIRE(copy.id == gauge.id);
+    REQUIRE(copy.fingerprint() == fingerprint);
+    REQUIRE(tui::Gauge().id != gauge.id);
+
+    gauge.set_percent(20);
+    REQUIRE(gauge.fingerprint() != fingerprint);
+    fingerprint = gauge.fingerprint();
+    gauge.set_dimensions(1, 0, 10, 3);
+    REQUIRE(gauge.fingerprint() != fingerprint);
+
+    // Content members are tracked through the generation
+    tui::List list;
+    list.rows = {"Foo"};
+    fingerprint = list.fingerprint();
+    list.rows.push_back("Bar");
+    REQUIRE(list.fingerprint() == fingerprint);
+    list.touch();
+    REQUIRE(list.fingerprint() != fingerprint);
+    fingerprint = list.fingerprint();
+    list.set_rows({"Baz"});
+    REQUIRE(list.fingerprint() != fingerprint);
+}
+
+TEST_CASE("Rect", "[rect]") {
+    // Test rectangle containment and intersection
+    tui::Rect rect = {0, 0, 10, 5};
+    REQUIRE(rect.contains({2, 1, 8, 4}));
+    REQUIRE(!rect.contains({2, 1, 9, 4}));
+    tui::Rect overlap = rect.intersect({5, 3, 10, 10});
+    REQUIRE(overlap.x == 5);
+    REQUIRE(overlap.y == 3);
+    REQUIRE(overlap.width == 5);
+    REQUIRE(overlap.height == 2);
+    REQUIRE(rect.intersect({20, 0, 5, 5}).empty());
+}
+
+// Cell buffer target which fails on writes outside of it
+struct GridTarget {
+    int columns;
+    int rows;
+    std::vector<tui::Cell> cells;
+    bool out_of_bounds = false;
+
+    GridTarget(int columns_, int rows_) : columns(columns_), rows(rows_), cells(columns_ * rows_) {}
+
+    void put(int x, int y, char c, short color) {
+        if(x < 0 || x >= columns || y < 0 || y >= rows) {
+            out_of_bounds = true;
+            return;
+        }
+        cells[y * columns + x] = {c, color};
+    }
+
+    void put_color(int x, int y, short color) {
+        put(x, y, cells[y * columns + x].glyph, color);
+    }
+
+    char glyph(int x, int y) const {
+        return cells[y * columns + x].glyph;
+    }
+};
+
+TEST_CASE("Draw Context", "[draw_context]") {
+    // Test that widgets never draw outside their clip
+    GridTarget target(8, 4);
+    tui::DrawContext<GridTarget> screen(target, {0, 0, 8, 4});
+
+    tui::Gauge gauge;
+    gauge.set_dimensions(-2, -1, 20, 10);
+    gauge.percent = 50;
+    gauge.bar_color = tui::GREEN;
+    gauge.label = "50%";
+    tui::DrawContext<GridTarget> context = screen.clipped(gauge.rect());
+    tui::paint(context, gauge);
+    REQUIRE(!target.out_of_bounds);
+    REQUIRE(target.glyph(0, 0) != '+');
+
+    tui::BarChart bar_chart;
+    bar_chart.data = {1, 2, 3};
+    bar_chart.bar_width = 4;
+    bar_chart.bar_color = tui::RED;
+    bar_chart.set_dimensions(4, 1, 30, 30);
+    context = screen.clipped(bar_chart.rect());
+    tui::paint(context, bar_chart);
+    REQUIRE(!target.out_of_bounds);
+
+    // Parent clip restricts drawing further
+    tui::Paragraph paragraph;
+    paragraph.text = "Foo";
+    paragraph.set_dimensions(0, 0, 8, 4);
+    context = screen.clipped({0, 0, 2, 4}).clipped(paragraph.rect());
+    tui::paint(context, paragraph);
+    REQUIRE(target.glyph(0, 0) == '+');
+    REQUIRE(target.glyph(1, 1) == 'F');
+    REQUIRE(target.glyph(2, 1) != 'o');
+    REQUIRE(target.glyph(2, 0) != '-');
+}
+
+// Counts cells written
+struct CountingTarget : GridTarget {
+    int writes = 0;
+
+    CountingTarget(int columns_, int rows_) : GridTarget(columns_, rows_) {}
+
+    void put(int x, int y, char c, short color) {
+        writes++;
+        GridTarget::put(x, y, c, color);
+    }
+
+    void put_color(int x, int y, short color) {
+        writes++;
+        GridTarget::put_color(x, y, color);
+    }
+};
+
+// Counts rows copied with blit_row
+struct RowTarget : CountingTarget {
+    int rows_copied = 0;
+
+    RowTarget(int columns_, int rows_) : CountingTarget(columns_, rows_) {}
+
+    void blit_row(int x, int y, const tui::Cell *cells, int count) {
+        rows_copied++;
+        for(int i = 0; i < count; i++) {
+            GridTarget::put(x + i, y, cells[i].glyph, cells[i].color);
+        }
+    }
+};
+
+// Draw widget in full into a fresh grid
+template<typename Widget>
+std::vector<tui::Cell> full_paint(const Widget &widget, int columns, int rows) {
+    GridTarget target(columns, rows);
+    tui::DrawContext<GridTarget> context(target, {0, 0, columns, rows});
+    tui::paint(context, widget);
+    return target.cells;
+}
+
+TEST_CASE("Delta Painting", "[delta_painting]") {
+    // Test that only changed cells are drawn and the result matches a full paint
+    CountingTarget target(40, 12);
+    tui::DrawContext<CountingTarget> context(target, {0, 0, 40, 12});
+    tui::PaintState state;
+
+    tui::Gauge gauge;
+    gauge.set_dimensions(0, 0, 22, 3);
+    gauge.label = "Loading";
+    gauge.bar_color = tui::GREEN;
+    gauge.percent = 0;
+    tui::paint_changes(context, gauge, state);
+    REQUIRE(target.cells == full_paint(gauge, 40, 12));
+
+    // One more column of the bar
+    gauge.set_percent(5);
+    target.writes = 0;
+    tui::paint_changes(context, gauge, state);
+    REQUIRE(target.writes == 1);
+    REQUIRE(target.cells == full_paint(gauge, 40, 12));
+
+    // Bar passes under the label, label cells change background
+    gauge.set_percent(50);
+    target.writes = 0;
+    tui::paint_changes(context, gauge, state);
+    REQUIRE(target.writes == 9);
+    REQUIRE(target.cells == full_paint(gauge, 40, 12));
+    gauge.set_percent(10);
+    tui::paint_changes(context, gauge, state);
+    REQUIRE(target.cells == full_paint(gauge, 40, 12));
+
+    // Same bar width draws nothing
+    gauge.set_percent(11);
+    target.writes = 0;
+    tui::paint_changes(context, gauge, state);
+    REQUIRE(target.writes == 0);
+
+    // Anything else draws in full
+    gauge.set_label("Done");
+    tui::paint_changes(context, gauge, state);
+    REQUIRE(target.cells == full_paint(gauge, 40, 12));
+
+    tui::BarChart bar_chart;
+    bar_chart.set_dimensions(0, 0, 22, 12);
+    bar_chart.bar_width = 4;
+    bar_chart.labels = {"a", "b", "c", "d"};
+    bar_chart.data = {90, 30, 60, 10};
+    target = CountingTarget(40, 12);
+    state = tui::PaintState();
+    tui::paint_changes(context, bar_chart, state);
+    REQUIRE(target.cells == full_paint(bar_chart, 40, 12));
+
+    // Value changes without changing height redraw the number only
+    bar_chart.set_data({90, 30, 60, 11});
+    target.writes = 0;
+    tui::paint_changes(context, bar_chart, state);
+    REQUIRE(target.writes == 4);
+    REQUIRE(target.cells == full_paint(bar_chart, 40, 12));
+
+    // Shrinking bars blank the rows above them
+    bar_chart.set_data({90, 80, 10, 11});
+    tui::paint_changes(context, bar_chart, state);
+    REQUIRE(target.cells == full_paint(bar_chart, 40, 12));
+
+    // A new maximum changes every height
+    bar_chart.set_data({180, 80, 10, 11});
+    tui::paint_changes(context, bar_chart, state);
+    REQUIRE(target.cells == full_paint(bar_chart, 40, 12));
+
+    // Unchanged data draws nothing
+    bar_chart.touch();
+    target.writes = 0;
+    tui::paint_changes(context, bar_chart, state);
+    REQUIRE(target.writes == 0);
+}
+
+TEST_CASE("Hit Map", "[hit_map]") {
+    // Test that cells remember the widget drawn last
+    tui::HitMap hits;
+    hits.reset(10, 5);
+    REQUIRE(hits.at(0, 0) == 0);
+    hits.mark({0, 0, 6, 5}, 1);
+    hits.mark({4, 2, 20, 20}, 2);
+    REQUIRE(hits.at(0, 0) == 1);
+    REQUIRE(hits.at(5, 1) == 1);
+    REQUIRE(hits.at(5, 2) == 2);
+    REQUIRE(hits.at(9, 4) == 2);
+    REQUIRE(hits.at(10, 4) == 0);
+    REQUIRE(hits.at(-1, 0) == 0);
+
+    // Selected and hovered rows are filled across the list
+    GridTarget target(12, 5);
+    tui::DrawContext<GridTarget> context(target, {0, 0, 12, 5});
+    tui::List list;
+    list.rows = {"Foo", "Bar", "Baz"};
+    list.set_dimensions(0, 0, 12, 5);
+    tui::paint(context, list);
+    short blank = target.cells[1 * 12 + 8].color;
+    list.selected = 0;
+    list.hovered = 1;
+    tui::paint(context, list);
+    REQUIRE(target.glyph(1, 1) == 'F');
+    REQUIRE(target.cells[1 * 12 + 8].color != blank);
+    REQUIRE(target.cells[2 * 12 + 8].color != blank);
+    REQUIRE(target.cells[1 * 12 + 8].color != target.cells[2 * 12 + 8].color);
+    REQUIRE(target.cells[3 * 12 + 8].color == blank);
+}
+
+// Window stand-in recording what lists ask to draw
+struct ListWindow {
+    tui::HitMap hits;
+    int scrolled = 0;
+    std::vector<int> redrawn;
+
+    uint64_t widget_at(int x, int y) const {
+        return hits.at(x, y);
+    }
+
+    void scroll_list(const tui::List &, int lines) {
+        scrolled += lines;
+    }
+
+    void redraw_list_elements(const tui::List &, int previous, int current) {
+        redrawn.push_back(previous);
+        redrawn.push_back(current);
+    }
+};
+
+TEST_CASE("List Mouse Events", "[list_mouse_events]") {
+    // Test that lists handle mouse events over the cells the hit map gives them
+    tui::List list;
+    list.rows = {"[0] Foo", "[1] Bar", "[2] Baz", "[3] Qux", "[4] Quux"};
+    list.set_dimensions(1, 1, 10, 4);
+    ListWindow window;
+    window.hits.reset(30, 10);
+    window.hits.mark(list.rect(), list.id);
+    window.hits.mark({11, 1, 10, 4}, list.id + 1);
+
+    tui::Event event;
+    event.type = tui::MOUSEBUTTONDOWN;
+    event.button = tui::BUTTON_LEFT;
+    event.x = 3;
+    event.y = 3;
+    REQUIRE(list.handle_event(window, event));
+    REQUIRE(list.selected == 1);
+    REQUIRE(window.redrawn == std::vector<int>({-1, 1, -1, 1}));
+
+    // Borders and other widgets select nothing
+    event.y = 1;
+    REQUIRE(list.handle_event(window, event));
+    event.x = 12;
+    event.y = 3;
+    REQUIRE(!list.handle_event(window, event));
+    event.type = tui::MOUSEBUTTONUP;
+    REQUIRE(!list.handle_event(window, event));
+    REQUIRE(list.selected == 1);
+
+    event.type = tui::MOUSEWHEEL;
+    event.x = 3;
+    event.wheel = 2;
+    REQUIRE(list.handle_event(window, event));
+    REQUIRE(list.first_element == 2);
+    REQUIRE(window.scrolled == 2);
+    REQUIRE(list.hovered == 3);
+    event.x = 12;
+    REQUIRE(!list.handle_event(window, event));
+    REQUIRE(list.first_element == 2);
+
+    event.type = tui::MOUSEMOTION;
+    event.x = 3;
+    event.y = 2;
+    REQUIRE(list.handle_event(window, event));
+    REQUIRE(list.hovered == 2);
+    event.x = 12;
+    REQUIRE(!list.handle_event(window, event));
+    REQUIRE(list.hovered == -1);
+
+    // Cells left by a widget no longer reach it once the map is reset
+    window.hits.reset(30, 10);
+    event.type = tui::MOUSEBUTTONDOWN;
+    event.x = 3;
+    event.y = 2;
+    REQUIRE(!list.handle_event(window, event));
+    REQUIRE(list.selected == 1);
+
+    // Copies share the id but only handle events over their own rectangle
+    tui::List copy = list;
+    copy.set_dimensions(11, 1, 10, 4);
+    ListWindow copies;
+    copies.hits.reset(30, 10);
+    copies.hits.mark(list.rect(), list.id);
+    copies.hits.mark(copy.rect(), copy.id);
+    event.type = tui::MOUSEWHEEL;
+    event.x = 13;
+    event.y = 2;
+    event.wheel = -1;
+    REQUIRE(!list.handle_event(copies, event));
+    REQUIRE(list.first_element == 2);
+    REQUIRE(copy.handle_event(copies, event));
+    REQUIRE(copy.first_element == 1);
+    REQUIRE(copies.scrolled == -1);
+    event.type = tui::MOUSEBUTTONDOWN;
+    event.y = 3;
+    REQUIRE(!list.handle_event(copies, event));
+    REQUIRE(list.selected == 1);
+    REQUIRE(copy.handle_event(copies, event));
+    REQUIRE(copy.selected == 2);
+}
+
+TEST_CASE("Parallel Raster", "[parallel_raster]") {
+    // Test that widgets drawn on a pool give the same cells and styles as drawn serially
+    tui::detail::WorkStealingPool pool(4);
+    REQUIRE(pool.size() == 4);
+    std::vector<std::atomic<int> > runs(1000);
+    pool.run(runs.size(), [&](size_t i) {
+        runs[i]++;
+    });
+    REQUIRE(std::all_of(runs.begin(), runs.end(), [](const std::atomic<int> &count) {
+        return count == 1;
+    }));
+    pool.run(3, [&](size_t i) {
+        runs[i]++;
+    });
+    REQUIRE(runs[2] == 2);
+    REQUIRE(runs[3] == 1);
+    REQUIRE_THROWS_AS(pool.run(10, [](size_t i) {
+        if(i == 7) {
+            throw tui::TUIException("Failed job");
+        }
+    }), tui::TUIException);
+
+    std::vector<tui::Paragraph> paragraphs(40);
+    for(size_t i = 0; i < paragraphs.size(); i++) {
+        paragraphs[i].text = "Panel " + std::to_string(i);
+        paragraphs[i].text_style = {(int)(i % 8) + 16, tui::BLACK, tui::ATTR_BOLD};
+        // Overlapping panels, later ones are drawn above earlier ones
+        paragraphs[i].set_dimensions((int)(i % 8) * 5, (int)(i / 8) * 3, 9, 4);
+    }
+    tui::Gauge gauge;
+    gauge.percent = 40;
+    gauge.bar_color = tui::GREEN;
+    gauge.label = "40%";
+    gauge.set_dimensions(2, 2, 20, 3);
+
+    GridTarget serial(40, 16);
+    tui::StyleTable serial_styles;
+    tui::DrawContext<GridTarget> screen(serial, {0, 0, 40, 16}, &serial_styles);
+    for(const tui::Paragraph &paragraph : paragraphs) {
+        tui::DrawContext<GridTarget> context = screen.clipped(paragraph.rect());
+        tui::paint(context, paragraph);
+    }
+    tui::DrawContext<GridTarget> context = screen.clipped(gauge.rect());
+    tui::paint(context, gauge);
+
+    GridTarget parallel(40, 16);
+    tui::StyleTable parallel_styles;
+    tui::detail::RasterBatch batch;
+    for(int frame = 0; frame < 2; frame++) {
+        for(const tui::Paragraph &paragraph : paragraphs) {
+            batch.queue(paragraph, {0, 0, 40, 16});
+        }
+        batch.queue(gauge, {0, 0, 40, 16});
+        batch.run(pool, parallel, &parallel_styles);
+        REQUIRE(!parallel.out_of_bounds);
+        REQUIRE(parallel.cells == serial.cells);
+        REQUIRE(parallel_styles.size() == serial_styles.size());
+        REQUIRE(parallel_styles.get(parallel.cells[41].color) == serial_styles.get(serial.cells[41].color));
+    }
+
+    // Cells only colored keep the glyph below
+    tui::detail::RasterLayer layer;
+    layer.reset({1, 1, 2, 1});
+    layer.put(1, 1, 'x', 7);
+    layer.put_color(2, 1, tui::get_color(tui::RED, tui::BLACK));
+    parallel.put(2, 1, 'y', 7);
+    parallel.put(3, 1, 'z', 7);
+    layer.copy_to(parallel, &parallel_styles);
+    REQUIRE(parallel.glyph(1, 1) == 'x');
+    REQUIRE(parallel.glyph(2, 1) == 'y');
+    REQUIRE(parallel.cells[40 + 2].color == tui::get_color(tui::RED, tui::BLACK));
+    REQUIRE(parallel.glyph(3, 1) == 'z');
+
+    // Targets with blit_row get one call per row of a layer instead of one put per cell
+    RowTarget rows(40, 16);
+    tui::StyleTable row_styles;
+    for(const tui::Paragraph &paragraph : paragraphs) {
+        batch.queue(paragraph, {0, 0, 40, 16});
+    }
+    batch.queue(gauge, {0, 0, 40, 16});
+    batch.run(pool, rows, &row_styles);
+    REQUIRE(rows.cells == serial.cells);
+    REQUIRE(rows.writes == 0);
+    RowTarget split(8, 4);
+    layer.reset({1, 1, 4, 2});
+    // A cell only colored splits the second row
+    for(int x = 1; x < 5; x++) {
+        layer.put(x, 1, 'a', 7);
+        if(x != 3) {
+            layer.put(x, 2, 'b', 7);
+        }
+    }
+    layer.put_color(3, 2, 7);
+    layer.copy_to(split, &row_styles);
+    REQUIRE(split.rows_copied == 1 + 2);
+    REQUIRE(split.writes == 1);
+    REQUIRE(split.glyph(4, 2) == 'b');
+}
+
+TEST_CASE("Surface", "[surface]") {
+    // Test drawing widgets into surfaces and blitting surfaces
+    tui::Paragraph paragraph;
+    paragraph.text = "Foo";
+    paragraph.set_dimensions(10, 5, 6, 3);
+
+    tui::Surface panel;
+    panel.reset(paragraph.rect());
+    panel.add(paragraph);
+    REQUIRE(panel.columns() == 6);
+    REQUIRE(panel.rows() == 3);
+    REQUIRE(panel.at(10, 5).glyph == '+');
+    REQUIRE(panel.at(11, 6).glyph == 'F');
+    REQUIRE(panel.row(1)[3].glyph == 'o');
+
+    // Blit is clipped to the destination
+    tui::Surface frame(8, 8);
+    panel.set_origin(4, 6);
+    frame.blit(panel);
+    REQUIRE(frame.at(4, 6).glyph == '+');
+    REQUIRE(frame.at(5, 7).glyph == 'F');
+    REQUIRE(frame.at(7, 7).glyph == 'o');
+    REQUIRE(frame.at(3, 7).glyph == ' ');
+
+    frame.clear();
+    REQUIRE(frame.at(4, 6).glyph == ' ');
+}
+
+// Replay target with its own style table
+struct StyledTarget : ReplayTarget {
+    tui::StyleTable styles;
+
+    StyledTarget(int columns_, int rows_) : ReplayTarget(columns_, rows_) {}
+};
+
+TEST_CASE("Style Table", "[style_table]") {
+    // Test interning of styles and their ids in surfaces and recordings
+    tui::StyleTable styles;
+    REQUIRE(styles.intern({tui::RED, tui::BLUE}) == tui::get_color(tui::RED, tui::BLUE));
+    short bold = styles.intern({tui::RED, tui::BLUE, tui::ATTR_BOLD});
+    short true_color = styles.intern({tui::rgb(255, 128, 0), 236});
+    REQUIRE(bold == tui::StyleTable::plain_styles);
+    REQUIRE(true_color == bold + 1);
+    REQUIRE(styles.intern({tui::RED, tui::BLUE, tui::ATTR_BOLD}) == bold);
+    REQUIRE(styles.size() == tui::StyleTable::plain_styles + 2);
+    REQUIRE(styles.get(true_color).foreground == tui::rgb(255, 128, 0));
+    REQUIRE(styles.get(tui::get_color(tui::RED, tui::BLUE)) == tui::Style{tui::RED, tui::BLUE});
+    REQUIRE(tui::detail::nearest_palette(tui::rgb(255, 0, 0)) == 196);
+    REQUIRE(tui::detail::palette_rgb(196) == tui::rgb(255, 0, 0));
+    REQUIRE(tui::detail::nearest_ansi(tui::rgb(0, 200, 0)) == 2 + 8);
+
+    // A full table draws new styles in the nearest plain style instead of throwing
+    tui::StyleTable full;
+    for(int i = 0; full.size() < tui::StyleTable::capacity; i++) {
+        full.intern({tui::rgb(i & 0xFF, (i >> 8) & 0xFF, 1), tui::BLACK});
+    }
+    REQUIRE(full.intern({tui::rgb(0, 200, 0), tui::BLACK, tui::ATTR_BOLD}) == tui::get_color(2 + 8, tui::BLACK));
+    REQUIRE(full.intern({196, tui::BLUE}) == tui::get_color(1 + 8, tui::BLUE));
+    REQUIRE(full.intern({tui::rgb(0, 0, 1), tui::BLACK}) >= tui::StyleTable::plain_styles);
+    REQUIRE(full.size() == tui::StyleTable::capacity);
+
+    // Widgets intern their styles in the table of the surface they are drawn into
+    tui::Paragraph paragraph;
+    paragraph.text = "Foo";
+    paragraph.text_style = {tui::YELLOW, tui::BLACK, tui::ATTR_UNDERLINE};
+    paragraph.set_dimensions(0, 0, 6, 3);
+    tui::Surface panel;
+    panel.reset(paragraph.rect());
+    panel.add(paragraph);
+    REQUIRE(panel.styles.get(panel.at(1, 1).color) == paragraph.text_style);
+    REQUIRE(panel.at(0, 0).color == tui::get_color(tui::WHITE, tui::BLACK));
+    uint64_t fingerprint = paragraph.fingerprint();
+    paragraph.text_style.attributes = tui::ATTR_BOLD;
+    REQUIRE(paragraph.fingerprint() != fingerprint);
+
+    // Blitting moves styles into the table of the destination
+    tui::Surface frame(8, 4);
+    frame.styles.intern({tui::GREEN, tui::BLACK, tui::ATTR_REVERSE});
+    frame.blit(panel);
+    REQUIRE(frame.at(1, 1).color != panel.at(1, 1).color);
+    REQUIRE(frame.styles.get(frame.at(1, 1).color) == panel.styles.get(panel.at(1, 1).color));
+
+    // Recordings carry the styles of their frames
+    const char *path = "test_styles.tuir";
+    std::vector<tui::Cell> cells(4 * 2);
+    cells[0] = {'a', bold};
+    cells[1] = {'b', tui::get_color(tui::RED, tui::BLUE)};
+    {
+        tui::FrameRecorder recorder(path);
+        recorder.submit(cells.data(), 4, 2, &styles);
+        cells[2] = {'c', true_color};
+        recorder.submit(cells.data(), 4, 2, &styles);
+    }
+    tui::FrameReplayer replayer(path);
+    StyledTarget target(4, 2);
+    target.styles.intern({tui::BLUE, tui::BLUE, tui::ATTR_DIM});
+    REQUIRE(replayer.replay(target) == 2);
+    REQUIRE(replayer.get_cells() == cells);
+    REQUIRE(replayer.get_styles().get(true_color) == styles.get(true_color));
+    REQUIRE(target.styles.get(target.cells[0].color) == styles.get(bold));
+    REQUIRE(target.styles.get(target.cells[2].color) == styles.get(true_color));
+    REQUIRE(target.cells[1].color == tui::get_color(tui::RED, tui::BLUE));
+    remove(path);
+}
+
+TEST_CASE("Rich Text", "[rich_text]") {
+    // Test that markup is parsed into runs of styled text
+    tui::Paragraph paragraph;
+    paragraph.set_markup("[INFO] [bold red]error[/] in [yellow on blue]main[underline].cpp[/][/] [[x]");
+    REQUIRE(paragraph.text == "[INFO] error in main.cpp [x]");
+    REQUIRE(paragraph.spans.size() == 3);
+    REQUIRE(paragraph.spans[0] == tui::TextSpan{7, 5, {tui::RED, tui::BLACK, tui::ATTR_BOLD}});
+    REQUIRE(paragraph.spans[1] == tui::TextSpan{16, 4, {tui::YELLOW, tui::BLUE}});
+    REQUIRE(paragraph.spans[2] == tui::TextSpan{20, 4, {tui::YELLOW, tui::BLUE, tui::ATTR_UNDERLINE}});
+
+    // Appending merges runs of the same style
+    uint64_t generation = paragraph.generation;
+    paragraph.set_text("a");
+    REQUIRE(paragraph.spans.empty());
+    paragraph.append("b", {tui::GREEN, tui::BLACK});
+    paragraph.append("c", {tui::GREEN, tui::BLACK});
+    paragraph.append("d");
+    paragraph.append("e", {tui::GREEN, tui::BLACK});
+    REQUIRE(paragraph.generation > generation);
+    REQUIRE(paragraph.text == "abcde");
+    REQUIRE(paragraph.spans.size() == 2);
+    REQUIRE(paragraph.spans[0] == tui::TextSpan{1, 2, {tui::GREEN, tui::BLACK}});
+
+    // Runs are drawn in their style across wrapped rows
+    paragraph.set_markup("ab[red]cdefg[/]h");
+    paragraph.set_dimensions(0, 0, 5, 5);
+    tui::Surface panel;
+    panel.reset(paragraph.rect());
+    panel.add(paragraph);
+    tui::Style red = {tui::RED, tui::BLACK};
+    const char *rows[] = {"abc", "def", "gh"};
+    for(int y = 0; y < 3; y++) {
+        for(int x = 0; x < (int)strlen(rows[y]); x++) {
+            int offset = y * 3 + x;
+            REQUIRE(panel.at(1 + x, 1 + y).glyph == rows[y][x]);
+            bool styled = offset >= 2 && offset < 7;
+            REQUIRE(panel.styles.get(panel.at(1 + x, 1 + y).color) == (styled ? red : paragraph.text_style));
+        }
+    }
+}
+
+// Window stand-in with one widget under every cell
+struct HitTarget {
+    uint64_t id = 0;
+
+    uint64_t widget_at(int, int) const {
+        return id;
+    }
+};
+
+TEST_CASE("Pane Stack", "[pane_stack]") {
+    // Test that only the active pane is drawn and refreshed
+    tui::Paragraph paragraph1;
+    paragraph1.text = "One";
+    paragraph1.set_dimensions(0, 1, 10, 3);
+    tui::Paragraph paragraph2;
+    paragraph2.text = "Two";
+    paragraph2.set_dimensions(0, 1, 10, 3);
+    tui::Gauge gauge;
+    gauge.percent = 50;
+    gauge.label = "";
+    gauge.bar_color = tui::GREEN;
+    gauge.set_dimensions(0, 4, 10, 3);
+
+    tui::PaneStack panes;
+    panes.set_dimensions(0, 0, 20, 8);
+    REQUIRE(panes.add_pane("Logs", paragraph1) == 0);
+    REQUIRE(panes.add_pane("Load", paragraph2, gauge) == 1);
+    REQUIRE(panes.size() == 2);
+    REQUIRE(panes.surface().at(1, 2).glyph == 'O');
+    REQUIRE(panes.surface().bounds().y == 1);
+
+    int refreshes = 0;
+    panes.set_refresh(1, 100, [&]() {
+        refreshes++;
+        paragraph2.set_text("Two " + std::to_string(refreshes));
+    });
+    tui::PaneStack::Clock::time_point now = tui::PaneStack::Clock::now();
+    REQUIRE(!panes.refresh(now));
+    REQUIRE(panes.next_timeout(now) == -1);
+    panes.select(1);
+    REQUIRE(panes.refresh(now));
+    REQUIRE(!panes.refresh(now + std::chrono::milliseconds(50)));
+    REQUIRE(panes.next_timeout(now + std::chrono::milliseconds(50)) == 50);
+    REQUIRE(panes.refresh(now + std::chrono::milliseconds(100)));
+    REQUIRE(refreshes == 2);
+    REQUIRE(panes.surface().at(5, 2).glyph == '2');
+    REQUIRE(panes.surface().at(1, 5).glyph == '#');
+    REQUIRE(panes.widgets().size() == 2);
+
+    // Unchanged panes are blitted from their surface
+    paragraph1.text = "Foo";
+    panes.select(0);
+    REQUIRE(panes.surface().at(1, 2).glyph == 'O');
+    paragraph1.touch();
+    REQUIRE(panes.surface().at(1, 2).glyph == 'F');
+    REQUIRE_THROWS_AS(panes.select(2), tui::TUIException);
+
+    // Tabs are " title " separated by "|"
+    GridTarget target(20, 1);
+    tui::DrawContext<GridTarget> context(target, {0, 0, 20, 1});
+    tui::paint(context, panes.tabs);
+    std::string row;
+    for(int x = 0; x < 14; x++) {
+        row += target.glyph(x, 0);
+    }
+    REQUIRE(row == " Logs | Load |");
+    REQUIRE(panes.tabs.tab_at(0) == 0);
+    REQUIRE(panes.tabs.tab_at(6) == -1);
+    REQUIRE(panes.tabs.tab_at(7) == 1);
+
+    // Clicking a tab shows its pane
+    HitTarget window;
+    tui::Event event;
+    event.type = tui::MOUSEBUTTONDOWN;
+    event.button = tui::BUTTON_LEFT;
+    event.x = 9;
+    REQUIRE(!panes.handle_event(window, event));
+    window.id = panes.tabs.id;
+    REQUIRE(panes.handle_event(window, event));
+    REQUIRE(panes.active() == 1);
+}
+
+TEST_CASE("Heatmap", "[heatmap]") {
+    // Test pooling of a matrix to cells and mapping of values to glyphs
+    float values[4 * 8];
+    for(int i = 0; i < 4 * 8; i++) {
+        values[i] = (i % 8) / 8.0f;
+    }
+    values[0] = 1.0f;
+    tui::Heatmap heatmap;
+    heatmap.set_values(values, 4, 8);
+    heatmap.set_dimensions(0, 0, 6, 4);
+    heatmap.half_blocks = false;
+
+    GridTarget target(6, 4);
+    tui::DrawContext<GridTarget> screen(target, {0, 0, 6, 4});
+    tui::DrawContext<GridTarget> context = screen.clipped(heatmap.rect());
+    tui::paint(context, heatmap);
+    REQUIRE(!target.out_of_bounds);
+    // Cells cover 2 x 2 values, mean of 1, 0.125, 0, 0.125 is level 3 of 10
+    REQUIRE(target.glyph(1, 1) == '-');
+    REQUIRE(target.glyph(1, 2) == ' ');
+    REQUIRE(target.glyph(4, 1) == '%');
+
+    heatmap.pooling = tui::MAX_POOLING;
+    uint64_t fingerprint = heatmap.fingerprint();
+    heatmap.set_range(0, 2);
+    REQUIRE(heatmap.fingerprint() != fingerprint);
+    tui::paint(context, heatmap);
+    REQUIRE(target.glyph(1, 1) == '+');
+    REQUIRE(target.glyph(4, 2) == '=');
+
+    // Matrices smaller than the widget repeat values
+    heatmap.set_values(values, 1, 1);
+    heatmap.set_range(0, 1);
+    tui::paint(context, heatmap);
+    REQUIRE(target.glyph(4, 2) == '@');
+}
+
+TEST_CASE("Histogram", "[histogram]") {
+    // Test binning of samples and drawing through the bar chart
+    tui::Histogram histogram;
+    histogram.set_linear_bins(0, 10, 5);
+    REQUIRE(histogram.labels == std::vector<std::string>({"0", "2", "4", "6", "8"}));
+    const double samples[] = {0, 1, 2.5, 9.9, 100, -1};
+    histogram.push(samples, 6);
+    REQUIRE(histogram.data == std::vector<int>({3, 1, 0, 0, 2}));
+    histogram.push(3.0);
+    REQUIRE(histogram.data == std::vector<int>({3, 2, 0, 0, 2}));
+    REQUIRE(histogram.total == 7);
+    histogram.decay(0.5);
+    REQUIRE(histogram.counts[0] == 1.5);
+    REQUIRE(histogram.data[1] == 1);
+    // Counts beyond the range of int are drawn as the largest bar
+    histogram.counts[4] = 5e9;
+    histogram.decay(1);
+    REQUIRE(histogram.data[4] == INT_MAX);
+    histogram.push(9.0);
+    REQUIRE(histogram.data[4] == INT_MAX);
+    histogram.counts[4] = 1;
+    histogram.decay(1);
+
+    histogram.bar_width = 1;
+    histogram.bar_color = tui::BLUE;
+    histogram.set_dimensions(0, 0, 12, 8);
+    GridTarget target(12, 8);
+    tui::DrawContext<GridTarget> context(target, {0, 0, 12, 8});
+    tui::paint(context, histogram);
+    REQUIRE(!target.out_of_bounds);
+    REQUIRE(target.glyph(1, 6) == '0');
+    REQUIRE(target.glyph(3, 6) == '2');
+
+    histogram.set_log_bins(1, 1000, 3);
+    REQUIRE(histogram.bin_of(5) == 0);
+    REQUIRE(histogram.bin_of(50) == 1);
+    REQUIRE(histogram.bin_of(500) == 2);
+    REQUIRE(histogram.lower_edge(2) == Approx(100));
+
+    // HDR bins are exact below 2^(bits + 1) and keep bits + 1 significant bits above
+    histogram.set_hdr_bins(1, 1000, 2);
+    REQUIRE(histogram.counts.size() == 36);
+    REQUIRE(histogram.bin_of(7) == 7);
+    REQUIRE(histogram.bin_of(9) == 8);
+    REQUIRE(histogram.bin_of(10) == 9);
+    REQUIRE(histogram.lower_edge(9) == 10);
+    REQUIRE(histogram.lower_edge(35) == 896);
+    std::vector<double> latencies(1000);
+    for(size_t i = 0; i < latencies.size(); i++) {
+        latencies[i] = i;
+    }
+    histogram.push(latencies.data(), latencies.size());
+    REQUIRE(histogram.counts[9] == 2);
+    REQUIRE(histogram.percentile(50) == Approx(500).epsilon(0.05));
+    REQUIRE(histogram.percentile(99) == Approx(990).epsilon(0.05));
+    REQUIRE_THROWS_AS(histogram.set_log_bins(0, 10, 2), tui::TUIException);
+}
+
+// Wait for a table sort or filter and show its result
+bool settle(tui::Table &table) {
+    while(table.busy()) {
+        std::this_thread::yield();
+    }
+    return table.poll();
+}
+
+TEST_CASE("Table", "[table]") {
+    // Test columnar storage, layout and background sort and filter
+    tui::Table table;
+    REQUIRE(table.add_column("Name") == 0);
+    table.add_column("Pid", tui::TableColumn::INTEGER);
+    table.add_column("Cpu", tui::TableColumn::REAL, 1);
+    table.add_row("bash", 300, 1.25);
+    table.add_row("vim", 20, 12.5);
+    table.add_row("bash", 1000, 0.0);
+    table.add_row("basic", 7);
+    table.set_dimensions(0, 0, 20, 6);
+    REQUIRE(table.size() == 4);
+    REQUIRE(table.data->columns[0].strings.size() == 3);
+    REQUIRE(table.data->columns[0].width == 5);
+    REQUIRE(table.data->columns[1].width == 4);
+    REQUIRE(table.data->columns[2].width == 4);
+
+    GridTarget target(20, 6);
+    tui::DrawContext<GridTarget> screen(target, {0, 0, 20, 6});
+    tui::DrawContext<GridTarget> context = screen.clipped(table.rect());
+    tui::paint(context, table);
+    REQUIRE(!target.out_of_bounds);
+    REQUIRE(target.glyph(1, 1) == 'N');
+    REQUIRE(target.glyph(7, 1) == 'P');
+    REQUIRE(target.glyph(1, 2) == 'b');
+    REQUIRE(target.glyph(8, 2) == '3');
+    REQUIRE(target.glyph(12, 1) == 'C');
+    REQUIRE(target.glyph(13, 2) == '1');
+    REQUIRE(target.glyph(1, 5) == '-');
+
+    // Sorting replaces the view once the worker finished
+    table.sort_by(1, false);
+    REQUIRE(settle(table));
+    REQUIRE(*table.view == std::vector<uint32_t>({2, 0, 1, 3}));
+    table.sort_by(2);
+    REQUIRE(settle(table));
+    REQUIRE(*table.view == std::vector<uint32_t>({2, 0, 1, 3}));
+
+    // Filtering keeps the order and refines the previous result
+    table.filter_by(0, "bas");
+    REQUIRE(settle(table));
+    REQUIRE(*table.view == std::vector<uint32_t>({2, 0, 3}));
+    table.filter_by(0, "basi");
+    REQUIRE(settle(table));
+    REQUIRE(*table.view == std::vector<uint32_t>({3}));
+    table.filter_by(1, "0");
+    REQUIRE(settle(table));
+    REQUIRE(*table.view == std::vector<uint32_t>({2, 0, 1}));
+
+    // New rows are included after the view is computed again
+    table.add_row("basil", 100, 2.0);
+    REQUIRE(table.visible_size() == 3);
+    settle(table);
+    REQUIRE(settle(table));
+    REQUIRE(*table.view == std::vector<uint32_t>({2, 0, 4, 1}));
+    table.filter_by(0, "");
+    table.sort_by(-1);
+    REQUIRE(table.view == nullptr);
+
+    // Scrolling stops at the last row
+    table.scroll_down(10);
+    REQUIRE(table.first_element == 2);
+    table.scroll_up(10);
+    REQUIRE(table.first_element == 0);
+
+    // Copies share data until one is modified
+    tui::Table copy = table;
+    copy.add_row("top", 1, 1.0);
+    REQUIRE(copy.size() == 6);
+    REQUIRE(table.size() == 5);
+    REQUIRE(copy.fingerprint() != table.fingerprint());
+    REQUIRE_THROWS_AS(table.add_row("a", 1, 1.0, 4), tui::TUIException);
+    REQUIRE_THROWS_AS(table.add_row(1, "a"), tui::TUIException);
+    // A rejected row leaves every column at the same length
+    REQUIRE_THROWS_AS(table.add_row("a", "b"), tui::TUIException);
+    REQUIRE(table.size() == 5);
+    for(const tui::TableColumn &column : table.data->columns) {
+        REQUIRE(column.size() == 5);
+    }
+
+    // Queries replaced by later ones are cancelled and only the last one is shown
+    tui::Table large;
+    large.add_column("Value", tui::TableColumn::INTEGER);
+    for(int i = 0; i < 200000; i++) {
+        large.add_row((i * 7919) % 200000);
+    }
+    std::vector<std::shared_ptr<tui::detail::TableQuery> > replaced;
+    for(int i = 0; i < 20; i++) {
+        large.sort_by(0, i % 2 == 1);
+        replaced.push_back(large.query);
+    }
+    REQUIRE(settle(large));
+    REQUIRE(large.data->columns[0].integers[large.view->front()] == 0);
+    REQUIRE(large.data->columns[0].integers[large.view->back()] == 199999);
+    for(size_t i = 0; i + 1 < replaced.size(); i++) {
+        REQUIRE(replaced[i]->cancelled);
+    }
+}
+
+// Wait for a fuzzy search and take its result
+bool settle(tui::FuzzyFilter &filter) {
+    while(filter.busy()) {
+        std::this_thread::yield();
+    }
+    return filter.poll();
+}
+
+TEST_CASE("Fuzzy Filter", "[fuzzy_filter]") {
+    // Test matching, scoring and incremental background search
+    int score;
+    int positions[3];
+    REQUIRE(tui::detail::fuzzy_match("FooBar", 6, "fb", 2, score, positions));
+    REQUIRE(positions[0] == 0);
+    REQUIRE(positions[1] == 3);
+    REQUIRE(!tui::detail::fuzzy_match("foo", 3, "of", 2, score));
+    // The match ending first is shortened, word starts score more
+    REQUIRE(tui::detail::fuzzy_match("xa-ab", 5, "ab", 2, score, positions));
+    REQUIRE(positions[0] == 3);
+    REQUIRE(positions[1] == 4);
+    int prefix_score;
+    tui::detail::fuzzy_match("db-1", 4, "db", 2, prefix_score);
+    tui::detail::fuzzy_match("odb-1", 5, "db", 2, score);
+    REQUIRE(prefix_score > score);
+    REQUIRE((tui::detail::fuzzy_mask("abc", 3) & tui::detail::fuzzy_mask("CA", 2)) == tui::detail::fuzzy_mask("ca", 2));
+
+    tui::FuzzyFilter filter(2);
+    std::vector<std::string> rows = {"web-1", "db-1", "db-2", "cache", "odb"};
+    filter.set_rows(rows);
+    filter.search("db");
+    REQUIRE(settle(filter));
+    REQUIRE(*filter.matches() == std::vector<uint32_t>({1, 2, 4}));
+    REQUIRE(filter.text() == "db");
+    REQUIRE(filter.scores()->size() == 3);
+
+    // Extending the text only searches previous matches
+    filter.search("db2");
+    REQUIRE(settle(filter));
+    REQUIRE(*filter.matches() == std::vector<uint32_t>({2}));
+    filter.search("e");
+    REQUIRE(settle(filter));
+    REQUIRE(*filter.matches() == std::vector<uint32_t>({0, 3}));
+
+    // A cancelled search keeps the previous result
+    filter.search("c");
+    filter.cancel();
+    REQUIRE(!filter.busy());
+    REQUIRE(!filter.poll());
+    REQUIRE(filter.text() == "e");
+
+    // Lists show matches and highlight matched characters
+    tui::List list;
+    list.rows = rows;
+    list.set_dimensions(0, 0, 8, 4);
+    list.first_element = 3;
+    filter.search("DB");
+    REQUIRE(settle(filter));
+    uint64_t before = list.fingerprint();
+    filter.apply(list);
+    REQUIRE(list.fingerprint() != before);
+    REQUIRE(list.visible_size() == 3);
+    REQUIRE(list.first_element == 1);
+    list.first_element = 0;
+
+    GridTarget target(8, 4);
+    tui::DrawContext<GridTarget> context(target, {0, 0, 8, 4});
+    tui::paint(context, list);
+    short text_color = tui::get_color(list.text_style.foreground, list.text_style.background);
+    short highlight_color = tui::get_color(list.highlight_style.foreground, list.highlight_style.background);
+    REQUIRE(target.glyph(1, 1) == 'd');
+    REQUIRE(target.cells[1 * 8 + 1].color == highlight_color);
+    REQUIRE(target.cells[1 * 8 + 3].color == text_color);
+    REQUIRE(target.glyph(1, 2) == 'd');
+    REQUIRE(target.cells[2 * 8 + 2].color == highlight_color);
+
+    // An empty text shows every row
+    filter.search("");
+    filter.apply(list);
+    REQUIRE(list.view == nullptr);
+    REQUIRE(list.visible_size() == 5);
+
+    // Lists with other rows are rejected
+    list.rows.pop_back();
+    REQUIRE_THROWS_AS(filter.apply(list), tui::TUIException);
+}
+
+bool settle(tui::FileView &file_view) {
+    while(file_view.busy()) {
+        std::this_thread::yield();
+    }
+    return file_view.poll();
+}
+
+TEST_CASE("File View", "[file_view]") {
+    // Test indexing, drawing and following a memory mapped file
+    const char *path = "test_file_view.txt";
+    FILE *file = fopen(path, "wb");
+    REQUIRE(file != nullptr);
+    for(int i = 0; i < 200; i++) {
+        fprintf(file, i == 3 ? "a\tb\r\n" : "line %d\n", i);
+    }
+    fputs("tail", file);
+    fflush(file);
+
+    tui::FileView file_view;
+    file_view.set_dimensions(0, 0, 12, 5);
+    REQUIRE_THROWS_AS(file_view.open("missing_file.txt"), tui::TUIException);
+    file_view.open(path);
+    settle(file_view);
+    REQUIRE(file_view.size() == 201);
+    REQUIRE(file_view.file->checkpoints.size() == 4);
+
+    GridTarget target(12, 5);
+    tui::DrawContext<GridTarget> screen(target, {0, 0, 12, 5});
+    tui::DrawContext<GridTarget> context = screen.clipped(file_view.rect());
+    tui::paint(context, file_view);
+    REQUIRE(!target.out_of_bounds);
+    REQUIRE(target.glyph(1, 1) == 'l');
+    REQUIRE(target.glyph(6, 1) == '0');
+
+    // Lines after a checkpoint, tabs are expanded and carriage returns hidden
+    file_view.first_line = 130;
+    tui::paint(context, file_view);
+    REQUIRE(target.glyph(6, 1) == '1');
+    REQUIRE(target.glyph(8, 2) == '1');
+    file_view.first_line = 3;
+    tui::paint(context, file_view);
+    REQUIRE(target.glyph(1, 1) == 'a');
+    REQUIRE(target.glyph(8, 1) == ' ');
+    REQUIRE(target.glyph(9, 1) == 'b');
+    REQUIRE(target.glyph(10, 1) == ' ');
+
+    // Scrolling stops at the last line, the unterminated tail
+    file_view.scroll_down(1000);
+    REQUIRE(file_view.first_line == 198);
+    REQUIRE(file_view.follow);
+    tui::paint(context, file_view);
+    REQUIRE(target.glyph(1, 3) == 't');
+
+    // Appended lines are mapped and followed
+    fputs(" end\nmore\n", file);
+    fclose(file);
+    REQUIRE(file_view.poll());
+    settle(file_view);
+    REQUIRE(file_view.size() == 202);
+    REQUIRE(file_view.first_line == 199);
+    tui::paint(context, file_view);
+    REQUIRE(target.glyph(5, 2) == ' ');
+    REQUIRE(target.glyph(6, 2) == 'e');
+    REQUIRE(target.glyph(1, 3) == 'm');
+    file_view.scroll_up();
+    REQUIRE(!file_view.follow);
+
+    // Truncated files are indexed again
+    file = fopen(path, "wb");
+    fputs("short\n", file);
+    fclose(file);
+    file_view.poll();
+    settle(file_view);
+    REQUIRE(file_view.size() == 1);
+    REQUIRE(file_view.first_line == 0);
+    file_view.close();
+    REQUIRE(file_view.size() == 0);
+    remove(path);
+}
+
+TEST_CASE("Event Coalescing", "[event_coalescing]") {
+    // Test merging of repeated wheel, motion and resize events
+    tui::Event events[8];
+    events[0].type = tui::WINDOWRESIZE;
+    events[1].type = tui::MOUSEWHEEL;
+    events[1].wheel = 1;
+    events[2].type = tui::MOUSEWHEEL;
+    events[2].wheel = 1;
+    events[3].type = tui::KEYDOWN;
+    events[3].key = 'j';
+    events[4].type = tui::KEYDOWN;
+    events[4].key = 'j';
+    events[5].type = tui::MOUSEMOTION;
+    events[5].x = 1;
+    events[6].type = tui::MOUSEMOTION;
+    events[6].x = 2;
+    events[7].type = tui::WINDOWRESIZE;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(int i = 0; i < 8; i++) {
+        events[i].time = start + std::chrono::milliseconds(i);
+    }
+
+    REQUIRE(tui::coalesce_events(events, 8) == 5);
+    REQUIRE(events[0].type == tui::MOUSEWHEEL);
+    REQUIRE(events[0].wheel == 2);
+    REQUIRE(events[1].key == 'j');
+    REQUIRE(events[2].key == 'j');
+    REQUIRE(events[3].type == tui::MOUSEMOTION);
+    REQUIRE(events[3].x == 2);
+    REQUIRE(events[4].type == tui::WINDOWRESIZE);
+    // Merged events keep the time of their earliest input
+    REQUIRE(events[3].time == start + std::chrono::milliseconds(5));
+    REQUIRE(events[4].time == start);
+}
+
+TEST_CASE("Latency Stats", "[latency_stats]") {
+    // Test percentiles of event latencies by type and phase
+    tui::LatencyStats stats;
+    REQUIRE(stats.count(tui::KEYDOWN) == 0);
+    REQUIRE(stats.report().empty());
+    for(int i = 1; i <= 100; i++) {
+        const double durations[tui::LatencyStats::phases] = {10, 100.0 * i, 50, 40, 100.0 * i + 100};
+        stats.record(tui::KEYDOWN, durations);
+    }
+    const double wheel[tui::LatencyStats::phases] = {5, 5, 5, 5, 20};
+    stats.record(tui::MOUSEWHEEL, wheel);
+    REQUIRE(stats.count(tui::KEYDOWN) == 100);
+    REQUIRE(stats.count(tui::MOUSEWHEEL) == 1);
+    REQUIRE(stats.percentile(tui::KEYDOWN, 50) == Approx(5100).epsilon(0.07));
+    REQUIRE(stats.percentile(tui::KEYDOWN, 99) == Approx(10000).epsilon(0.07));
+    REQUIRE(stats.percentile(tui::KEYDOWN, 95, tui::PHASE_QUEUE) == Approx(10).epsilon(0.13));
+    REQUIRE(stats.histogram(tui::KEYDOWN, tui::PHASE_RASTER).total == 100);
+
+    std::string report = stats.report();
+    REQUIRE(report.find("KEYDOWN: 100 events") == 0);
+    REQUIRE(report.find("MOUSEWHEEL: 1 events") != std::string::npos);
+    stats.clear();
+    REQUIRE(stats.count(tui::KEYDOWN) == 0);
+}
+
+TEST_CASE("Output Pacer", "[output_pacer]") {
+    // Test holding frames back while the terminal lags and recovering once it drained
+    typedef std::chrono::milliseconds ms;
+    tui::OutputPacer::Clock::time_point start = tui::OutputPacer::Clock::now();
+    tui::OutputPacer pacer(1000);
+    REQUIRE(pacer.ready(start, 0));
+    pacer.written(start, start);
+    REQUIRE(pacer.interval() == 0);
+
+    REQUIRE_FALSE(pacer.ready(start, 5000));
+    REQUIRE(pacer.interval() == 16);
+    REQUIRE(pacer.next_timeout(start) == 16);
+    REQUIRE_FALSE(pacer.ready(start + ms(10), 0));
+    REQUIRE_FALSE(pacer.ready(start + ms(16), 5000));
+    REQUIRE(pacer.interval() == 32);
+    REQUIRE(pacer.lagged() == 2);
+
+    // Frames are written again once the backlog drained, ever sooner
+    tui::OutputPacer::Clock::time_point now = start + ms(48);
+    REQUIRE(pacer.ready(now, 0));
+    pacer.written(now, now);
+    REQUIRE(pacer.interval() == 23);
+    REQUIRE(pacer.next_timeout(now) == 23);
+    for(int i = 0; i < 10; i++) {
+        now += ms(pacer.interval());
+        REQUIRE(pacer.ready(now, 500));
+        pacer.written(now, now);
+    }
+    REQUIRE(pacer.interval() == 0);
+
+    // The interval is bounded while the terminal keeps lagging
+    for(int i = 0; i < 20; i++) {
+        now += ms(pacer.interval());
+        REQUIRE_FALSE(pacer.ready(now, 5000));
+    }
+    REQUIRE(pacer.interval() == 1000);
+    pacer.configure(1000, 50, 200);
+    REQUIRE(pacer.interval() == 200);
+    for(int i = 0; i < 10; i++) {
+        now += ms(pacer.interval());
+        REQUIRE(pacer.ready(now, 0));
+        pacer.written(now, now);
+    }
+    REQUIRE(pacer.interval() == 50);
+
+    // Writes which block count as lagging too
+    tui::OutputPacer stalled;
+    REQUIRE(stalled.ready(start, 0));
+    stalled.written(start, start + ms(40));
+    REQUIRE(stalled.interval() == 40);
+    REQUIRE(stalled.lagged() == 1);
+    REQUIRE(stalled.next_timeout(start) == 80);
+}
+
+TEST_CASE("Timer Wheel", "[timer_wheel]") {
+    typedef std::chrono::milliseconds ms;
+    tui::TimerWheel::Clock::time_point start = tui::TimerWheel::Clock::now();
+    tui::TimerWheel timers(start);
+    std::vector<int> fired;
+
+    REQUIRE(timers.next_timeout(start) == -1);
+    timers.schedule(5, [&]() { fired.push_back(5); });
+    tui::TimerWheel::TimerId late = timers.schedule(100, [&]() { fired.push_back(100); });
+    timers.schedule(5000, [&]() { fired.push_back(5000); });
+    tui::TimerWheel::TimerId repeating = timers.schedule(10, [&]() { fired.push_back(10); }, 10);
+    REQUIRE(timers.size() == 4);
+    REQUIRE(timers.next_timeout(start) == 5);
+    REQUIRE(timers.next_timeout(start + ms(3)) == 2);
+
+    REQUIRE(timers.advance(start + ms(4)) == 0);
+    REQUIRE(timers.advance(start + ms(35)) == 4);
+    REQUIRE(fired == std::vector<int>({5, 10, 10, 10}));
+    REQUIRE(timers.next_timeout(start + ms(35)) == 5);
+
+    // Cancelled timers never fire and cannot be cancelled twice
+    REQUIRE(timers.cancel(late));
+    REQUIRE_FALSE(timers.cancel(late));
+    REQUIRE(timers.cancel(repeating));
+    REQUIRE(timers.next_timeout(start + ms(35)) == 4965);
+    fired.clear();
+    REQUIRE(timers.advance(start + ms(4999)) == 0);
+    REQUIRE(timers.advance(start + ms(5000)) == 1);
+    REQUIRE(fired == std::vector<int>({5000}));
+    REQUIRE(timers.size() == 0);
+
+    // A timer cancelling itself and scheduling another from its callback
+    tui::TimerWheel::TimerId self = 0;
+    self = timers.schedule(1, [&]() {
+        fired.push_back(1);
+        timers.cancel(self);
+        timers.schedule(1, [&]() { fired.push_back(2); });
+    }, 1);
+    timers.advance(start + ms(5003));
+    REQUIRE(fired == std::vector<int>({5000, 1, 2}));
+    REQUIRE(timers.size() == 0);
+
+    // Timers beyond the span of the wheel still fire on time
+    timers.schedule(20000000, [&]() { fired.push_back(3); });
+    REQUIRE(timers.next_timeout(start + ms(5003)) == 20000000);
+    REQUIRE(timers.advance(start + ms(20005002)) == 0);
+    REQUIRE(timers.advance(start + ms(20005003)) == 1);
+
+    // Deadlines on slot boundaries of higher levels fire on their tick
+    tui::TimerWheel wheel(start);
+    std::vector<int> ticks;
+    auto tick_at = [&](int tick) {
+        return [&, tick]() {
+            ticks.push_back(tick);
+        };
+    };
+    wheel.schedule(64, tick_at(64));
+    wheel.schedule(4096, tick_at(4096));
+    for(int tick = 1; tick <= 4096; tick++) {
+        if(wheel.advance(start + ms(tick)) > 0) {
+            REQUIRE(ticks.back() == tick);
+        }
+    }
+    REQUIRE(ticks == std::vector<int>({64, 4096}));
+
+    // Repeating timers keep their phase across cascades
+    ticks.clear();
+    tui::TimerWheel repeat(start);
+    repeat.schedule(64, [&]() { ticks.push_back(0); }, 64);
+    for(int tick = 1; tick <= 200; tick++) {
+        if(repeat.advance(start + ms(tick)) > 0) {
+            ticks.back() = tick;
+        }
+    }
+    REQUIRE(ticks == std::vector<int>({64, 128, 192}));
+}
+
 #ifdef IS_WIN
 #include <string>
 
@@ -480,6 +1811,207 @@ TEST_CASE("Widget Equality", "[widget_equality]") {
     }
 }
 
+TEST_CASE("List Scrolling", "[list_scrolling]") {
+    // Test that scrolling by moving rows matches redrawing the list
+    tui::Window window;
+    tui::List list;
+    list.title = "List";
+    list.rows = {"[0] Foo", "[1] Bar", "[2] Baz", "[3] Qux", "[4] Quux"};
+    list.set_dimensions(1, 1, 10, 5);
+    window.add(list);
+    list.scroll_down(window);
+    list.scroll_down(window);
+    list.scroll_up(window);
+
+    tui::Window expected;
+    expected.add(list);
+
+    CHAR_INFO *content = window.get_content();
+    CHAR_INFO *expected_content = expected.get_content();
+    for(int i = 0; i < window.rows() * window.columns(); i++) {
+        REQUIRE(content[i].Char.AsciiChar == expected_content[i].Char.AsciiChar);
+        REQUIRE(content[i].Attributes == expected_content[i].Attributes);
+    }
+}
+
+TEST_CASE("Mouse Dispatch", "[mouse_dispatch]") {
+    // Test that mouse events reach the list under the pointer
+    tui::Window window;
+    tui::List list;
+    list.rows = {"[0] Foo", "[1] Bar", "[2] Baz", "[3] Qux", "[4] Quux"};
+    list.set_dimensions(1, 1, 10, 4);
+    tui::Paragraph paragraph;
+    paragraph.text = "Foo";
+    paragraph.set_dimensions(11, 1, 10, 4);
+    window.add(list, paragraph);
+    REQUIRE(window.widget_at(2, 2) == list.id);
+    REQUIRE(window.widget_at(12, 2) == paragraph.id);
+
+    tui::Event event;
+    event.type = tui::MOUSEBUTTONDOWN;
+    event.button = tui::BUTTON_LEFT;
+    event.x = 3;
+    event.y = 3;
+    REQUIRE(list.handle_event(window, event));
+    REQUIRE(list.selected == 1);
+    event.x = 12;
+    REQUIRE(!list.handle_event(window, event));
+    REQUIRE(list.selected == 1);
+
+    event.type = tui::MOUSEWHEEL;
+    event.x = 3;
+    event.wheel = 2;
+    REQUIRE(list.handle_event(window, event));
+    REQUIRE(list.first_element == 2);
+    REQUIRE(list.hovered == 3);
+
+    event.type = tui::MOUSEMOTION;
+    event.y = 2;
+    REQUIRE(list.handle_event(window, event));
+    REQUIRE(list.hovered == 2);
+    event.x = 12;
+    REQUIRE(!list.handle_event(window, event));
+    REQUIRE(list.hovered == -1);
+
+    // Rows drawn for the events match redrawing the list
+    tui::Window expected;
+    expected.add(list);
+    CHAR_INFO *content = window.get_content();
+    CHAR_INFO *expected_content = expected.get_content();
+    for(int i = 0; i < window.rows(); i++) {
+        for(int j = 0; j < 11; j++) {
+            int k = i * window.columns() + j;
+            REQUIRE(content[k].Char.AsciiChar == expected_content[k].Char.AsciiChar);
+            REQUIRE(content[k].Attributes == expected_content[k].Attributes);
+        }
+    }
+}
+
+TEST_CASE("Window Panes", "[window_panes]") {
+    // Test that the window shows the active pane and finds its widgets
+    tui::Window window;
+    tui::Paragraph paragraph1;
+    paragraph1.text = "One";
+    paragraph1.set_dimensions(0, 1, 10, 3);
+    tui::Paragraph paragraph2;
+    paragraph2.text = "Two";
+    paragraph2.set_dimensions(0, 1, 10, 3);
+    tui::PaneStack panes;
+    panes.set_dimensions(0, 0, 20, 4);
+    panes.add_pane("A", paragraph1);
+    panes.add_pane("B", paragraph2);
+    window.add(panes);
+    CHAR_INFO *content = window.get_content();
+    REQUIRE(content[2 * window.columns() + 1].Char.AsciiChar == 'O');
+    REQUIRE(window.widget_at(1, 2) == paragraph1.id);
+    REQUIRE(window.widget_at(1, 0) == panes.tabs.id);
+
+    panes.select(1);
+    window.add(panes);
+    REQUIRE(content[2 * window.columns() + 1].Char.AsciiChar == 'T');
+    REQUIRE(window.widget_at(1, 2) == paragraph2.id);
+
+    // Cells only a hidden pane covers no longer lead to its widgets
+    tui::List list;
+    list.rows = {"Foo", "Bar", "Baz", "Qux"};
+    list.set_dimensions(10, 1, 10, 3);
+    tui::PaneStack stack;
+    stack.set_dimensions(0, 0, 20, 4);
+    stack.add_pane("A", paragraph1, list);
+    stack.add_pane("B", paragraph2);
+    window.add(stack);
+    REQUIRE(window.widget_at(12, 2) == list.id);
+    stack.select(1);
+    window.add(stack);
+    REQUIRE(window.widget_at(12, 2) == stack.id);
+    tui::Event event;
+    event.type = tui::MOUSEWHEEL;
+    event.x = 12;
+    event.y = 2;
+    event.wheel = 1;
+    REQUIRE(!list.handle_event(window, event));
+    REQUIRE(list.first_element == 0);
+}
+
+TEST_CASE("Widget Cache", "[widget_cache]") {
+    // Test that unchanged widgets are not drawn again
+    tui::Window window;
+    window.set_widget_cache(true);
+    tui::Paragraph paragraph;
+    paragraph.text = "Foo";
+    paragraph.set_dimensions(0, 0, 10, 3);
+    window.add(paragraph);
+    CHAR_INFO *content = window.get_content();
+    int index = window.columns() + 1;
+    REQUIRE(content[index].Char.AsciiChar == 'F');
+
+    window.draw_char(1, 1, 'X');
+    window.add(paragraph);
+    REQUIRE(content[index].Char.AsciiChar == 'X');
+
+    paragraph.set_text("Bar");
+    window.add(paragraph);
+    REQUIRE(content[index].Char.AsciiChar == 'B');
+}
+
+TEST_CASE("Widget Layers", "[widget_layers]") {
+    // Test that stacked widgets are composed from the top layer down
+    tui::Window window;
+    tui::List background;
+    background.rows = {"0123456789012345", "0123456789012345", "0123456789012345"};
+    background.set_dimensions(0, 0, 20, 5);
+
+    tui::Paragraph popup;
+    popup.text = "Pop";
+    popup.set_dimensions(2, 1, 8, 3);
+    popup.layer = 1;
+    popup.opaque = true;
+
+    tui::Paragraph hidden;
+    hidden.text = "Hidden";
+    hidden.set_dimensions(3, 1, 6, 3);
+
+    window.stack(popup, background, hidden);
+    window.compose();
+
+    CHAR_INFO *content = window.get_content();
+    int columns = window.columns();
+    REQUIRE(content[2 * columns + 3].Char.AsciiChar == 'P');
+    REQUIRE(content[2 * columns + 6].Char.AsciiChar == ' ');
+    REQUIRE(content[1 * columns + 2].Char.AsciiChar == '+');
+    REQUIRE(content[2 * columns + 12].Char.AsciiChar == '1');
+    REQUIRE(content[2 * columns + 1].Char.AsciiChar == '0');
+}
+
+TEST_CASE("Surface Blit", "[surface_blit]") {
+    // Test that cached widgets are blitted into the window
+    tui::Window window;
+    tui::Gauge gauge;
+    gauge.set_dimensions(1, 1, 10, 3);
+    gauge.percent = 50;
+    gauge.bar_color = tui::GREEN;
+    tui::Surface cache;
+    window.add_cached(gauge, cache);
+    uint64_t fingerprint = cache.fingerprint;
+    REQUIRE(fingerprint == gauge.fingerprint());
+
+    CHAR_INFO *content = window.get_content();
+    int columns = window.columns();
+    REQUIRE(content[columns + 1].Char.AsciiChar == '+');
+    REQUIRE(content[2 * columns + 2].Attributes == tui::get_color(tui::WHITE, tui::GREEN));
+
+    // Unchanged widgets reuse the cache
+    window.add_cached(gauge, cache);
+    REQUIRE(cache.fingerprint == fingerprint);
+    gauge.set_percent(60);
+    window.add_cached(gauge, cache);
+    REQUIRE(cache.fingerprint != fingerprint);
+
+    // Surfaces can be blitted anywhere
+    window.blit(cache, 20, 1);
+    REQUIRE(content[columns + 20].Char.AsciiChar == '+');
+}
+
 TEST_CASE("Color Handling", "[color_handling]") {
     // Test color constants and bitwise operations
     REQUIRE(tui::get_color(tui::BLACK, tui::WHITE)            == 0x00F0);
@@ -501,5 +2033,312 @@ TEST_CASE("Color Handling", "[color_handling]") {
     REQUIRE(tui::get_color(tui::DARK_GRAY, tui::GRAY)         == 0x0078);
 }
 #elif defined(IS_POSIX)
+TEST_CASE("List Scrolling", "[list_scrolling]") {
+    // Test that full width lists moved with the terminal scroll region match redrawing the list
+    // The window needs a terminal description
+    const char *terminal = getenv("TERM");
+    if(terminal == nullptr || *terminal == '\0') {
+        return;
+    }
+    tui::Window window;
+    tui::List list;
+    list.title = "List";
+    list.rows = {"[0] Foo", "[1] Bar", "[2] Baz", "[3] Qux", "[4] Quux", "[5] Corge"};
+    // Full width, so scroll_rect() uses setscrreg() and scrl()
+    list.set_dimensions(0, 1, window.columns(), 5);
+    window.add(list);
+    list.scroll_down(window);
+    list.scroll_down(window);
+    list.scroll_up(window);
+    std::vector<tui::Cell> scrolled;
+    window.snapshot(scrolled);
 
+    // clear() leaves the screen to the next frame, erase it so the list is drawn from scratch
+    erase();
+    window.clear();
+    window.add(list);
+    std::vector<tui::Cell> expected;
+    window.snapshot(expected);
+
+    // Clipped lists are drawn again within the clip, cells outside it stay
+    erase();
+    window.clear();
+    list.first_element = 0;
+    window.add(list);
+    std::vector<tui::Cell> before;
+    window.snapshot(before);
+    window.push_clip({0, 0, window.columns(), 3});
+    list.scroll_down(window);
+    window.pop_clip();
+    std::vector<tui::Cell> clipped;
+    window.snapshot(clipped);
+
+    // Lists below a stacked widget are drawn again instead of moving its cells
+    erase();
+    window.clear();
+    list.first_element = 0;
+    tui::Paragraph popup;
+    popup.text = "Pop";
+    popup.set_dimensions(2, 2, 8, 3);
+    popup.layer = 1;
+    popup.opaque = true;
+    window.add(list);
+    window.stack(popup);
+    window.compose();
+    list.scroll_down(window);
+    std::vector<tui::Cell> covered;
+    window.snapshot(covered);
+    int columns = window.columns();
+    window.close();
+
+    REQUIRE(list.first_element == 1);
+    for(size_t i = 0; i < expected.size(); i++) {
+        REQUIRE(scrolled[i].glyph == expected[i].glyph);
+        REQUIRE(scrolled[i].color == expected[i].color);
+        const tui::Cell &shown = (int)i < 3 * columns ? expected[i] : before[i];
+        REQUIRE(clipped[i].glyph == shown.glyph);
+        REQUIRE(covered[i].glyph == expected[i].glyph);
+    }
+}
+
+TEST_CASE("Terminal Writer", "[terminal_writer]") {
+    // Test that writes to stdout return while the terminal reads nothing
+    int terminal[2];
+    REQUIRE(pipe(terminal) == 0);
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    dup2(terminal[1], STDOUT_FILENO);
+    close(terminal[1]);
+
+    // Far more than the pipe standing in for the terminal holds
+    std::string written(1 << 20, 'x');
+    written.back() = 'y';
+    std::string received;
+    size_t unwritten = 0;
+    size_t left = 1;
+    {
+        tui::TerminalWriter writer;
+        if(writer.start()) {
+            fwrite(written.data(), 1, written.size(), stdout);
+            fflush(stdout);
+            unwritten = writer.unwritten();
+            char buffer[4096];
+            while(received.size() < written.size()) {
+                ssize_t got = read(terminal[0], buffer, sizeof(buffer));
+                if(got <= 0) {
+                    break;
+                }
+                received.append(buffer, got);
+            }
+            writer.stop();
+            left = writer.unwritten();
+        }
+    }
+    // Reports go to stdout, so check once it is back
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+    close(terminal[0]);
+    REQUIRE(unwritten >= written.size() / 2);
+    REQUIRE(received == written);
+    REQUIRE(left == 0);
+}
+
+TEST_CASE("Broadcast Server", "[broadcast_server]") {
+    // Test that frames are fanned out to clients of a local socket
+    const char *path = "test_broadcast.sock";
+    tui::BroadcastServer server(path, 256);
+
+    auto connect_client = [&]() {
+        int client = socket(AF_UNIX, SOCK_STREAM, 0);
+        struct sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        strcpy(address.sun_path, path);
+        REQUIRE(connect(client, (struct sockaddr *)&address, sizeof(address)) == 0);
+        fcntl(client, F_SETFL, fcntl(client, F_GETFL) | O_NONBLOCK);
+        return client;
+    };
+    auto receive = [](int client) {
+        std::string bytes;
+        char buffer[4096];
+        ssize_t count;
+        while((count = recv(client, buffer, sizeof(buffer), 0)) > 0) {
+            bytes.append(buffer, count);
+        }
+        return bytes;
+    };
+
+    std::vector<tui::Cell> frame(10 * 4);
+    frame[0] = {'A', 0};
+    int first = connect_client();
+    server.submit(frame.data(), 10, 4);
+    REQUIRE(server.client_count() == 1);
+    std::string bytes = receive(first);
+    REQUIRE(bytes.find("\x1B[2J") != std::string::npos);
+    REQUIRE(bytes.find('A') != std::string::npos);
+
+    // Only changed cells are sent after the first frame
+    frame[15] = {'B', tui::get_color(tui::RED, tui::BLUE)};
+    int second = connect_client();
+    server.submit(frame.data(), 10, 4);
+    REQUIRE(receive(first) == "\x1B[2;6H\x1B[0;31;44mB");
+    bytes = receive(second);
+    REQUIRE(bytes.find("\x1B[2J") != std::string::npos);
+    REQUIRE(bytes.find('B') != std::string::npos);
+
+    // A client which stops reading is resynchronized with a full frame
+    // instead of receiving every queued diff
+    std::vector<tui::Cell> big(100 * 50);
+    const int frames = 400;
+    for(int i = 0; i < frames; i++) {
+        std::fill(big.begin(), big.end(), tui::Cell{(char)('a' + i % 26), 0});
+        server.submit(big.data(), 100, 50);
+        receive(second);
+    }
+    size_t received = 0;
+    for(int i = 0; i < 1000; i++) {
+        bytes = receive(first);
+        received += bytes.size();
+        server.serve();
+    }
+    REQUIRE(received < frames * big.size() / 2);
+    REQUIRE(bytes.empty());
+
+    close(first);
+    close(second);
+    server.serve();
+    server.submit(frame.data(), 10, 4);
+    REQUIRE(server.client_count() == 0);
+
+    // Styles with attributes and extended colors are sent as SGR parameters
+    tui::StyleTable styles;
+    std::vector<tui::Cell> styled = frame;
+    styled[0].color = styles.intern({tui::rgb(255, 128, 0), 236, tui::ATTR_BOLD | tui::ATTR_UNDERLINE});
+    std::string diff;
+    tui::encode_frame(frame.data(), styled.data(), 10, 4, diff, &styles);
+    REQUIRE(diff == "\x1B[1;1H\x1B[0;1;4;38;2;255;128;0;48;5;236mA");
+}
+
+TEST_CASE("Input Decoder", "[input_decoder]") {
+    // Test decoding of raw terminal input
+    tui::InputDecoder decoder;
+    tui::Event event;
+    auto feed = [&](const std::string &bytes) {
+        decoder.feed(bytes.data(), bytes.size());
+    };
+
+    SECTION("Keys") {
+        feed("q\x1B[A\x1B[1;5C\x1BOP\x1B[3~\x03\x1Bx\r\xC3\xA9");
+        REQUIRE(decoder.next(event));
+        REQUIRE(event.type == tui::KEYDOWN);
+        REQUIRE(event.key == 'q');
+        REQUIRE(decoder.next(event));
+        REQUIRE(event.key == KEY_UP);
+        REQUIRE(decoder.next(event));
+        REQUIRE(event.key == KEY_RIGHT);
+        REQUIRE(event.modifiers == tui::MOD_CTRL);
+        REQUIRE(decoder.next(event));
+        REQUIRE(event.key == KEY_F(1));
+        REQUIRE(decoder.next(event));
+        REQUIRE(event.key == KEY_DC);
+        REQUIRE(decoder.next(event));
+        REQUIRE(event.key == 3);
+        REQUIRE(event.modifiers == tui::MOD_CTRL);
+        REQUIRE(decoder.next(event));
+        REQUIRE(event.key == 'x');
+        REQUIRE(event.modifiers == tui::MOD_ALT);
+        REQUIRE(decoder.next(event));
+        REQUIRE(event.key == '\n');
+        REQUIRE(decoder.next(event));
+        REQUIRE(event.key == 0xE9);
+        REQUIRE(!decoder.next(event));
+        REQUIRE(!decoder.pending());
+    }
+    SECTION("Split Sequences") {
+        feed("\x1B[");
+        REQUIRE(!decoder.next(event));
+        REQUIRE(decoder.pending());
+        feed("B");
+        REQUIRE(decoder.next(event));
+        REQUIRE(event.key == KEY_DOWN);
+        // A lone escape is only decoded once flushed
+        feed("\x1B");
+        REQUIRE(!decoder.next(event));
+        REQUIRE(decoder.flush(event));
+        REQUIRE(event.key == 27);
+    }
+    SECTION("Mouse") {
+        feed("\x1B[<0;10;5M\x1B[<0;10;5m\x1B[<34;3;4M\x1B[<65;1;1M\x1B[<20;2;2M");
+        REQUIRE(decoder.next(event));
+        REQUIRE(event.type == tui::MOUSEBUTTONDOWN);
+        REQUIRE(event.button == tui::BUTTON_LEFT);
+        REQUIRE(event.x == 9);
+        REQUIRE(event.y == 4);
+        REQUIRE(decoder.next(event));
+        REQUIRE(event.type == tui::MOUSEBUTTONUP);
+        REQUIRE(decoder.next(event));
+        REQUIRE(event.type == tui::MOUSEMOTION);
+        REQUIRE(event.button == tui::BUTTON_RIGHT);
+        REQUIRE(decoder.next(event));
+        REQUIRE(event.type == tui::MOUSEWHEEL);
+        REQUIRE(event.wheel == 1);
+        REQUIRE(decoder.next(event));
+        REQUIRE(event.type == tui::MOUSEBUTTONDOWN);
+        REQUIRE(event.modifiers == (tui::MOD_SHIFT | tui::MOD_CTRL));
+    }
+    SECTION("Focus And Paste") {
+        feed("\x1B[I\x1B[200~hello\x1B[20");
+        REQUIRE(decoder.next(event));
+        REQUIRE(event.type == tui::FOCUSIN);
+        REQUIRE(decoder.next(event));
+        REQUIRE(event.type == tui::PASTE);
+        REQUIRE(std::string(event.text, event.length) == "hello");
+        REQUIRE(!decoder.next(event));
+        feed("1~\x1B[O");
+        REQUIRE(decoder.next(event));
+        REQUIRE(event.type == tui::FOCUSOUT);
+    }
+}
+#endif
+
+#ifdef TUI_COROUTINES
+tui::Task<int> coroutine_work(tui::EventLoop &loop, int value) {
+    co_await loop.sleep_for(5);
+    int result = co_await loop.run_in_thread([value]() { return value * 2; });
+    co_return result;
+}
+
+tui::Task<> coroutine_sum(tui::EventLoop &loop, int &total) {
+    total = co_await coroutine_work(loop, 1) + co_await coroutine_work(loop, 20);
+}
+
+tui::Task<> coroutine_await_empty(bool &thrown) {
+    tui::Task<int> empty;
+    try {
+        co_await empty;
+    } catch(const tui::TUIException &) {
+        thrown = true;
+    }
+}
+
+TEST_CASE("Coroutine Event Loop", "[coroutine_event_loop]") {
+    // Test that timers and threads resume coroutines until every task finished
+#ifdef IS_POSIX
+    // The window needs a terminal description
+    const char *terminal = getenv("TERM");
+    if(terminal == nullptr || *terminal == '\0') {
+        return;
+    }
+#endif
+    tui::Window window;
+    tui::EventLoop loop(window);
+    int total = 0;
+    bool thrown = false;
+    loop.spawn(coroutine_sum(loop, total));
+    loop.spawn(coroutine_await_empty(thrown));
+    loop.run();
+    window.close();
+    REQUIRE(total == 42);
+    REQUIRE(thrown);
+}
 #endif
\ No newline at end of file